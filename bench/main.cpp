@@ -0,0 +1,222 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <graph_lattice.h>
+#include <lattice_type.h>
+#include <node_order.h>
+#include <random.h>
+#include <threshold_finder.h>
+
+using namespace lattice;
+using Clock = std::chrono::steady_clock;
+
+/*
+ * Prints one CSV line per measurement, so that the output of two builds can be joined and compared:
+ *   benchmark,lattice,size,mode,engine,threads,parameter,value,unit
+ * Usage: lattice_bench [size...], the default sizes are 10 50 100 250.
+ */
+
+static const uint64_t SEED = 20200101;
+static const double MIN_SECONDS = 0.2;
+
+static const char *mode_name(ThresholdFinder::Mode mode) {
+    return mode == ThresholdFinder::EDGES ? "edges" : "nodes";
+}
+
+static const char *engine_name(ThresholdFinder::Engine engine) {
+    switch (engine) {
+        case ThresholdFinder::UNION_FIND:
+            return "union_find";
+        case ThresholdFinder::BISECTION:
+            return "bisection";
+        default:
+            return "drop_and_dfs";
+    }
+}
+
+static void report(const std::string &benchmark, LatticeType type, size_t size, const std::string &mode,
+                   const std::string &engine, size_t threads, const std::string &parameter, double value,
+                   const std::string &unit) {
+    std::cout << benchmark << ',' << lattice_name(type) << ',' << size << ',' << mode << ',' << engine << ','
+              << threads << ',' << parameter << ',' << value << ',' << unit << std::endl;
+}
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Repeats body until MIN_SECONDS have been spent inside it, body returns the time of its measured part
+template<class Body>
+static double average_seconds(Body body) {
+    double spent = 0;
+    size_t repetitions = 0;
+    while (spent < MIN_SECONDS || repetitions == 0) {
+        spent += body();
+        ++repetitions;
+    }
+    return spent / repetitions;
+}
+
+static void bench_construction(LatticeType type, size_t size) {
+    double seconds = average_seconds([&]() {
+        auto start = Clock::now();
+        auto lat = make_lattice(type, size);
+        return seconds_since(start);
+    });
+    report("construction", type, size, "", "", 1, "", seconds * 1e3, "ms");
+}
+
+static void bench_drop(LatticeType type, size_t size, ThresholdFinder::Mode mode) {
+    size_t dropped = 0;
+    double seconds = average_seconds([&]() {
+        auto lat = make_lattice(type, size);
+        const size_t total = mode == ThresholdFinder::EDGES ? lat->edges().size() : lat->nodes().size();
+        std::vector<size_t> order(total);
+        for (size_t i = 0; i < total; ++i)
+            order[i] = i;
+        Random rng(SEED);
+        for (size_t i = 0; i + 1 < total; ++i)
+            std::swap(order[i], order[i + rng.below(total - i)]);
+
+        // Half of the elements are dropped, which is about where the thresholds of the built-in lattices are
+        dropped = total / 2;
+        auto start = Clock::now();
+        for (size_t i = 0; i < dropped; ++i) {
+            if (mode == ThresholdFinder::EDGES)
+                lat->drop_edge_between(lat->edges()[order[i]].node_a, lat->edges()[order[i]].node_b);
+            else
+                lat->drop_node(order[i]);
+        }
+        return seconds_since(start);
+    });
+    report("drop", type, size, mode_name(mode), "", 1, "", seconds / dropped * 1e9, "ns/op");
+}
+
+static void bench_is_permeable(LatticeType type, size_t size, ThresholdFinder::Mode mode, double fill) {
+    auto lat = make_lattice(type, size);
+    const size_t total = mode == ThresholdFinder::EDGES ? lat->edges().size() : lat->nodes().size();
+
+    RemovalMask removed(total);
+    Random rng(SEED);
+    for (size_t i = 0; i < total; ++i)
+        if (rng.uniform() >= fill)
+            removed.set(i);
+
+    double seconds = average_seconds([&]() {
+        auto start = Clock::now();
+        auto path = ThresholdFinder::is_permeable(*lat, mode, removed);
+        return seconds_since(start);
+    });
+    std::ostringstream parameter;
+    parameter << "fill=" << fill;
+    report("is_permeable", type, size, mode_name(mode), "", 1, parameter.str(), seconds * 1e6, "us");
+}
+
+// is_permeable on the lattice written as a graph file with its nodes in the given order. The removed elements are drawn
+// over the original ids and renumbered with the lattice, so every order tests the same configuration.
+static void bench_layout(LatticeType type, size_t size, ThresholdFinder::Mode mode, NodeOrder order, double fill) {
+    char path[] = "/tmp/lattice_bench_layoutXXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0)
+        throw std::runtime_error("Can't create a temporary graph file");
+    close(fd);
+
+    RemovalMask removed;
+    {
+        auto lat = make_lattice(type, size);
+        const std::vector<size_t> new_ids = node_order(type, size, order);
+        GraphLattice::write(path, *lat, new_ids);
+
+        const bool edges = mode == ThresholdFinder::EDGES;
+        const std::vector<size_t> renumbered = edges ? GraphLattice::edge_ids(*lat, new_ids) : new_ids;
+        removed.reset(renumbered.size());
+        Random rng(SEED);
+        for (size_t i = 0; i < renumbered.size(); ++i)
+            if (rng.uniform() >= fill)
+                removed.set(renumbered[i]);
+    }
+    GraphLattice graph(path);
+    std::remove(path);
+
+    double seconds = average_seconds([&]() {
+        auto start = Clock::now();
+        auto path_found = ThresholdFinder::is_permeable(graph, mode, removed);
+        return seconds_since(start);
+    });
+
+    std::ostringstream parameter;
+    parameter << "order=" << order_name(order) << " fill=" << fill;
+    report("layout", type, size, mode_name(mode), "", 1, parameter.str(), seconds * 1e6, "us");
+}
+
+static void bench_run(LatticeType type, size_t size, ThresholdFinder::Mode mode, ThresholdFinder::Engine engine,
+                      ThreadPool &pool) {
+    auto lat = make_lattice(type, size);
+
+    // The number of realizations doubles until a run takes long enough to be measured
+    size_t iterations = pool.size();
+    double seconds;
+    while (true) {
+        auto start = Clock::now();
+        ThresholdFinder::run(iterations, pool, mode, *lat, engine, SEED);
+        seconds = seconds_since(start);
+        if (seconds >= MIN_SECONDS)
+            break;
+        iterations *= 2;
+    }
+    report("run", type, size, mode_name(mode), engine_name(engine), pool.size(), "", iterations / seconds,
+           "samples/s");
+}
+
+int main(int argc, char **argv) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i)
+        sizes.push_back(std::stoul(argv[i]));
+    if (sizes.empty())
+        sizes = {10, 50, 100, 250};
+
+    const std::vector<LatticeType> types = {HEXAGONAL, TRIANGULAR, SQUARE};
+    const std::vector<ThresholdFinder::Mode> modes = {ThresholdFinder::EDGES, ThresholdFinder::NODES};
+    const std::vector<ThresholdFinder::Engine> engines = {ThresholdFinder::DROP_AND_DFS, ThresholdFinder::UNION_FIND,
+                                                          ThresholdFinder::BISECTION};
+
+    std::vector<size_t> thread_counts = {1};
+    if (std::thread::hardware_concurrency() > 1)
+        thread_counts.push_back(std::thread::hardware_concurrency());
+
+    std::cout << "benchmark,lattice,size,mode,engine,threads,parameter,value,unit" << std::endl;
+
+    for (auto type : types) {
+        for (auto size : sizes) {
+            bench_construction(type, size);
+            for (auto mode : modes) {
+                bench_drop(type, size, mode);
+                for (double fill : {1.0, 0.8, 0.6, 0.5})
+                    bench_is_permeable(type, size, mode, fill);
+                for (auto order : {ROW_MAJOR, MORTON, HILBERT})
+                    for (double fill : {1.0, 0.6})
+                        bench_layout(type, size, mode, order, fill);
+            }
+        }
+    }
+
+    for (auto threads : thread_counts) {
+        ThreadPool pool(threads);
+        for (auto type : types)
+            for (auto size : sizes)
+                for (auto mode : modes)
+                    for (auto engine : engines)
+                        bench_run(type, size, mode, engine, pool);
+    }
+
+    return 0;
+}
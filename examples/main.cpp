@@ -3,79 +3,44 @@
 #include <iostream>
 #include <thread>
 #include <map>
-#include <fstream>
-#include <threshold_finder.h>
-#include <hexagonal_lattice.h>
-#include <triangular_lattice.h>
-#include <square_lattice.h>
+#include <result_file.h>
+#include <sweep.h>
 
 using namespace lattice;
 
-ThresholdFinder::Result
-run_threshold_finder_with_default_parameters(size_t iterations,
-                                             const std::function<std::unique_ptr<Lattice>()> &generator) {
-    const auto processor_count = std::thread::hardware_concurrency();
-    return ThresholdFinder::run(
-            iterations,
-            processor_count > 0 ? processor_count : 4,
-            ThresholdFinder::Mode::EDGES,
-            generator
-    );
-}
-
 int main() {
-    enum LatticeType {
-        Hexagonal, Triangular, Square
-    };
     std::map<LatticeType, std::map<size_t, size_t>> settings = {
-            {Hexagonal,  {{10, 1000}, {50, 1000}, {100, 250}, {250, 50}, {500, 10}, {1000, 10}}},
-            {Triangular, {{10, 1000}, {50, 1000}, {100, 250}, {250, 50}, {500, 10}, {1000, 10}}},
-            {Square,     {{10, 1000}, {50, 1000}, {100, 250}, {250, 50}, {500, 10}, {1000, 10}}}
-    };
-
-    std::map<LatticeType, std::string> type_to_name = {
-            {Hexagonal,  "hexagonal"},
-            {Triangular, "triangular"},
-            {Square,     "square"}
+            {HEXAGONAL,  {{10, 1000}, {50, 1000}, {100, 250}, {250, 50}, {500, 10}, {1000, 10}}},
+            {TRIANGULAR, {{10, 1000}, {50, 1000}, {100, 250}, {250, 50}, {500, 10}, {1000, 10}}},
+            {SQUARE,     {{10, 1000}, {50, 1000}, {100, 250}, {250, 50}, {500, 10}, {1000, 10}}}
     };
 
+    std::vector<Sweep::Entry> entries;
     for (const auto &type_to_sizes : settings) {
-        LatticeType type = type_to_sizes.first;
-        std::string name = type_to_name[type];
-
-        std::cout << "Starting to compute thresholds of " << name << " lattices!" << std::endl;
         for (const auto &size_to_count : type_to_sizes.second) {
-            size_t size = size_to_count.first;
-            size_t count = size_to_count.second;
+            entries.push_back({type_to_sizes.first, size_to_count.first, size_to_count.second, ThresholdFinder::Mode::EDGES});
+        }
+    }
 
-            ThresholdFinder::Result result;
-            if (type == Hexagonal) {
-                result = run_threshold_finder_with_default_parameters(
-                        count,
-                        [size]() -> std::unique_ptr<Lattice> { return std::make_unique<HexagonalLattice>(size); }
-                );
-            } else if (type == Triangular) {
-                result = run_threshold_finder_with_default_parameters(
-                        count,
-                        [size]() -> std::unique_ptr<Lattice> { return std::make_unique<TriangularLattice>(size); }
-                );
-            } else if (type == Square) {
-                result = run_threshold_finder_with_default_parameters(
-                        count,
-                        [size]() -> std::unique_ptr<Lattice> { return std::make_unique<SquareLattice>(size); }
-                );
-            }
-            auto filename = name + "_" + std::to_string(size) + "_" + std::to_string(count) + ".csv";
-            std::ofstream output(filename);
+    const auto processor_count = std::thread::hardware_concurrency();
+    ThreadPool pool(processor_count > 0 ? processor_count : 4);
 
-            for (const auto &threshold : result.thresholds) {
-                output << threshold << std::endl;
-            }
-            output.close();
+    // All the lattices and sizes are scheduled at once, results are reported in order of completion
+    const auto engine = ThresholdFinder::DROP_AND_DFS;
+    ResultWriter output("thresholds.lres");
 
-            std::cout << count << " iterations with " << size << "x" << size << ": " << result.average() << std::endl;
-        }
-    }
+    std::cout << "Starting to compute thresholds of " << entries.size() << " lattices!" << std::endl;
+    Sweep::run(entries, pool, engine, Random::entropy_seed(),
+               [&output, engine](size_t, const Sweep::Entry &entry, const ThresholdFinder::Result &result) {
+                   std::string name = lattice_name(entry.type);
+                   size_t size = entry.size, count = entry.iterations;
+
+                   output.write(entry.type, size, entry.mode, engine, result);
+
+                   std::cout << count << " iterations with " << name << " " << size << "x" << size << ": "
+                             << result.statistics.mean() << " +- " << result.statistics.standard_error() << std::endl;
+               });
+    output.close();
     std::cout << "Done!" << std::endl;
     return 0;
-}
\ No newline at end of file
+}
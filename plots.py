@@ -6,26 +6,45 @@ import pandas as pd
 import seaborn as sns
 from matplotlib import pyplot as plt
 
-df = pd.read_csv('out/percolation_thresholds.csv')
-grouped_by_size = df.groupby('size')
+# Layout of the record header written by lattice::ResultWriter (src/result_file.h)
+RECORD_HEADER = np.dtype([
+    ('magic', 'S8'), ('version', '<u4'), ('lattice_type', '<u4'), ('size', '<u8'), ('mode', '<u4'), ('engine', '<u4'),
+    ('seed', '<u8'), ('count', '<u8'), ('mean', '<f8'), ('variance', '<f8'), ('standard_error', '<f8'),
+    ('min', '<f8'), ('max', '<f8'), ('histogram_low', '<f8'), ('histogram_high', '<f8'), ('histogram_bins', '<u8'),
+    ('reserved', '<u8', 2),
+])
 
-size_mean = grouped_by_size.apply(np.mean)
-size_mean['size'] = size_mean.index
-size_std = grouped_by_size.apply(np.std)
-size_std['size'] = size_std.index
 
-sns.set(font_scale=3)
-fig, ax = plt.subplots(1, 1, figsize=(10, 10))
-sns.barplot('size', 'threshold', data=size_mean, ax=ax)
-ax.set_title('')
-ax.set(xlabel='', ylabel='')
-plt.savefig('mean-plot.png')
-fig.show()
+def read_results(path):
+    """Yields (header, thresholds) for every record, thresholds are views into the memory-mapped file."""
+    data = np.memmap(path, dtype=np.uint8, mode='r')
+    offset = 0
+    while offset < len(data):
+        header = data[offset:offset + RECORD_HEADER.itemsize].view(RECORD_HEADER)[0]
+        assert header['magic'] == b'LATTRES', '{} is not a result file'.format(path)
+        offset += RECORD_HEADER.itemsize + 8 * int(header['histogram_bins'])
+        count = int(header['count'])
+        yield header, data[offset:offset + 8 * count].view('<f8')
+        offset += 8 * count
+
+
+# Names of the enums stored in the record header, in the order of their values
+LATTICE_TYPES = ['hexagonal', 'triangular', 'square', 'cubic', 'bcc', 'fcc']
+MODES = ['edges', 'nodes']
+ENGINES = ['drop_and_dfs', 'union_find', 'bisection']
+
+df = pd.concat(pd.DataFrame({'lattice': LATTICE_TYPES[int(header['lattice_type'])], 'mode': MODES[int(header['mode'])],
+                             'engine': ENGINES[int(header['engine'])], 'size': int(header['size']),
+                             'threshold': thresholds})
+               for header, thresholds in read_results('out/thresholds.lres'))
+
+# One value per lattice, mode, engine and size, so that records of different lattices are never averaged together
+per_size = df.groupby(['lattice', 'mode', 'engine', 'size'])['threshold'].agg([np.mean, np.std]).reset_index()
 
 sns.set(font_scale=3)
-fig, ax = plt.subplots(1, 1, figsize=(10, 10))
-sns.barplot('size', 'threshold', data=size_std, ax=ax)
-ax.set_title('')
-ax.set(xlabel='', ylabel='')
-plt.savefig('std-plot.png')
+for statistic, filename in [('mean', 'mean-plot.png'), ('std', 'std-plot.png')]:
+    grid = sns.catplot(x='size', y=statistic, hue='lattice', col='mode', row='engine', data=per_size, kind='bar',
+                       height=10)
+    grid.set_axis_labels('', '')
+    grid.savefig(filename)
 plt.show()
@@ -0,0 +1,312 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <exception>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <graph_lattice.h>
+#include <lattice_type.h>
+#include <threshold_finder.h>
+
+using namespace lattice;
+
+/*
+ * Python module exposing the lattices and ThresholdFinder::run. Thresholds are returned as an object implementing the
+ * buffer protocol over the vector filled by the run, so numpy.asarray() or memoryview() view it without a copy.
+ */
+
+// The lattice is shared with the runs in progress, so that re-initializing the object while the GIL is released
+// doesn't free a lattice the workers still read
+struct LatticeObject {
+    PyObject_HEAD
+    std::shared_ptr<const Lattice> lattice;
+};
+
+struct ThresholdsObject {
+    PyObject_HEAD
+    ThresholdFinder::Result *result;
+    Py_ssize_t shape;
+    Py_ssize_t stride;
+};
+
+static const LatticeType TYPES[] = {HEXAGONAL, TRIANGULAR, SQUARE, CUBIC, BCC, FCC};
+
+static bool set_error(const std::exception_ptr &error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::invalid_argument &e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+    } catch (const std::bad_alloc &) {
+        PyErr_NoMemory();
+    } catch (const std::exception &e) {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+    }
+    return false;
+}
+
+// Lattice
+
+static PyObject *lattice_new(PyTypeObject *type, PyObject *, PyObject *) {
+    PyObject *self = type->tp_alloc(type, 0);
+    if (self != nullptr)
+        new(&reinterpret_cast<LatticeObject *>(self)->lattice) std::shared_ptr<const Lattice>();
+    return self;
+}
+
+static void lattice_dealloc(LatticeObject *self) {
+    self->lattice.~shared_ptr();
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+static int lattice_init(LatticeObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = {"type", "size", "storage", nullptr};
+    const char *name, *storage = "explicit";
+    Py_ssize_t size;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sn|s", const_cast<char **>(keywords), &name, &size, &storage))
+        return -1;
+    if (size < 1) {
+        PyErr_SetString(PyExc_ValueError, "size must be positive");
+        return -1;
+    }
+
+    const std::string storage_name = storage;
+    if (storage_name != "explicit" && storage_name != "implicit") {
+        PyErr_SetString(PyExc_ValueError, "storage must be 'explicit' or 'implicit'");
+        return -1;
+    }
+    for (LatticeType type : TYPES) {
+        if (lattice_name(type) != name)
+            continue;
+        std::unique_ptr<Lattice> lattice;
+        try {
+            lattice = make_lattice(type, size, storage_name == "implicit" ? Lattice::IMPLICIT : Lattice::EXPLICIT);
+        } catch (...) {
+            set_error(std::current_exception());
+            return -1;
+        }
+        self->lattice = std::move(lattice);
+        return 0;
+    }
+    PyErr_Format(PyExc_ValueError, "unknown lattice type '%s'", name);
+    return -1;
+}
+
+static PyObject *lattice_node_count(LatticeObject *self, void *) {
+    return PyLong_FromSize_t(self->lattice != nullptr ? self->lattice->node_count() : 0);
+}
+
+static PyObject *lattice_edge_count(LatticeObject *self, void *) {
+    return PyLong_FromSize_t(self->lattice != nullptr ? self->lattice->edge_count() : 0);
+}
+
+static PyGetSetDef lattice_getset[] = {
+        {"node_count", reinterpret_cast<getter>(lattice_node_count), nullptr, nullptr, nullptr},
+        {"edge_count", reinterpret_cast<getter>(lattice_edge_count), nullptr, nullptr, nullptr},
+        {nullptr}
+};
+
+static PyTypeObject LatticeType_ = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static int graph_lattice_init(LatticeObject *self, PyObject *args, PyObject *) {
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s", &path))
+        return -1;
+    try {
+        self->lattice = std::make_shared<GraphLattice>(path);
+    } catch (...) {
+        set_error(std::current_exception());
+        return -1;
+    }
+    return 0;
+}
+
+static PyTypeObject GraphLatticeType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+// Thresholds
+
+static void thresholds_dealloc(ThresholdsObject *self) {
+    delete self->result;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+static int thresholds_getbuffer(ThresholdsObject *self, Py_buffer *view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "thresholds are read-only");
+        return -1;
+    }
+    std::vector<double> &thresholds = self->result->thresholds;
+    self->shape = thresholds.size();
+    self->stride = sizeof(double);
+
+    view->obj = reinterpret_cast<PyObject *>(self);
+    Py_INCREF(view->obj);
+    view->buf = thresholds.data();
+    view->len = thresholds.size() * sizeof(double);
+    view->readonly = 1;
+    view->itemsize = sizeof(double);
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char *>("d") : nullptr;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? &self->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->stride : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+static Py_ssize_t thresholds_length(ThresholdsObject *self) {
+    return self->result->thresholds.size();
+}
+
+static PyObject *thresholds_mean(ThresholdsObject *self, void *) {
+    return PyFloat_FromDouble(self->result->statistics.mean());
+}
+
+static PyObject *thresholds_standard_error(ThresholdsObject *self, void *) {
+    return PyFloat_FromDouble(self->result->statistics.standard_error());
+}
+
+static PyObject *thresholds_seed(ThresholdsObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->result->seed);
+}
+
+static PyBufferProcs thresholds_buffer = {
+        reinterpret_cast<getbufferproc>(thresholds_getbuffer), nullptr
+};
+
+static PySequenceMethods thresholds_sequence = {reinterpret_cast<lenfunc>(thresholds_length)};
+
+static PyGetSetDef thresholds_getset[] = {
+        {"mean", reinterpret_cast<getter>(thresholds_mean), nullptr, nullptr, nullptr},
+        {"standard_error", reinterpret_cast<getter>(thresholds_standard_error), nullptr, nullptr, nullptr},
+        {"seed", reinterpret_cast<getter>(thresholds_seed), nullptr,
+         const_cast<char *>("Master seed, passing it back to find_thresholds() reproduces the thresholds"), nullptr},
+        {nullptr}
+};
+
+static PyTypeObject ThresholdsType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+// Functions
+
+static PyObject *find_thresholds(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = {"lattice", "iterations", "mode", "engine", "threads", "seed", nullptr};
+    PyObject *lattice_object, *seed_object = Py_None;
+    Py_ssize_t iterations, threads = 0;
+    const char *mode_name = "edges", *engine_name = "drop_and_dfs";
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!n|ssnO", const_cast<char **>(keywords), &LatticeType_,
+                                     &lattice_object, &iterations, &mode_name, &engine_name, &threads, &seed_object))
+        return nullptr;
+
+    const std::string mode_string = mode_name, engine_string = engine_name;
+    if (mode_string != "edges" && mode_string != "nodes") {
+        PyErr_SetString(PyExc_ValueError, "mode must be 'edges' or 'nodes'");
+        return nullptr;
+    }
+    ThresholdFinder::Engine engine;
+    if (engine_string == "drop_and_dfs") {
+        engine = ThresholdFinder::DROP_AND_DFS;
+    } else if (engine_string == "union_find") {
+        engine = ThresholdFinder::UNION_FIND;
+    } else if (engine_string == "bisection") {
+        engine = ThresholdFinder::BISECTION;
+    } else {
+        PyErr_SetString(PyExc_ValueError, "engine must be 'drop_and_dfs', 'union_find' or 'bisection'");
+        return nullptr;
+    }
+    if (iterations < 0 || threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "iterations and threads must not be negative");
+        return nullptr;
+    }
+
+    uint64_t seed = Random::entropy_seed();
+    if (seed_object != Py_None) {
+        seed = PyLong_AsUnsignedLongLongMask(seed_object);
+        if (PyErr_Occurred())
+            return nullptr;
+    }
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const std::shared_ptr<const Lattice> lattice = reinterpret_cast<LatticeObject *>(lattice_object)->lattice;
+    if (lattice == nullptr) {
+        PyErr_SetString(PyExc_ValueError, "lattice is not initialized");
+        return nullptr;
+    }
+
+    // The copy above keeps the lattice alive without the GIL, even if the object is re-initialized meanwhile
+    std::unique_ptr<ThresholdFinder::Result> result(new ThresholdFinder::Result());
+    std::exception_ptr error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        *result = ThresholdFinder::run(iterations, threads,
+                                       mode_string == "edges" ? ThresholdFinder::EDGES : ThresholdFinder::NODES,
+                                       *lattice, engine, seed);
+        result->seed = seed;
+    } catch (...) {
+        error = std::current_exception();
+    }
+    Py_END_ALLOW_THREADS
+    if (error) {
+        set_error(error);
+        return nullptr;
+    }
+
+    auto thresholds = PyObject_New(ThresholdsObject, &ThresholdsType);
+    if (thresholds == nullptr)
+        return nullptr;
+    thresholds->result = result.release();
+    return reinterpret_cast<PyObject *>(thresholds);
+}
+
+static PyMethodDef methods[] = {
+        {"find_thresholds", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(find_thresholds)),
+         METH_VARARGS | METH_KEYWORDS,
+         "find_thresholds(lattice, iterations, mode='edges', engine='drop_and_dfs', threads=0, seed=None)\n\n"
+         "Runs ThresholdFinder on the lattice with the GIL released, threads=0 using every CPU. Returns read-only "
+         "thresholds supporting the buffer protocol, numpy.asarray() views them without copying."},
+        {nullptr}
+};
+
+static PyModuleDef module = {PyModuleDef_HEAD_INIT, "lattice", "Percolation thresholds of planar and volumetric lattices",
+                             -1, methods};
+
+PyMODINIT_FUNC PyInit_lattice() {
+    LatticeType_.tp_name = "lattice.Lattice";
+    LatticeType_.tp_basicsize = sizeof(LatticeObject);
+    LatticeType_.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
+    LatticeType_.tp_doc = "Lattice(type, size, storage='explicit'), type being e.g. 'square' or 'fcc'";
+    LatticeType_.tp_new = lattice_new;
+    LatticeType_.tp_init = reinterpret_cast<initproc>(lattice_init);
+    LatticeType_.tp_dealloc = reinterpret_cast<destructor>(lattice_dealloc);
+    LatticeType_.tp_getset = lattice_getset;
+
+    GraphLatticeType.tp_name = "lattice.GraphLattice";
+    GraphLatticeType.tp_basicsize = sizeof(LatticeObject);
+    GraphLatticeType.tp_flags = Py_TPFLAGS_DEFAULT;
+    GraphLatticeType.tp_doc = "GraphLattice(path), memory-mapping a graph file written by GraphLattice::write()";
+    GraphLatticeType.tp_base = &LatticeType_;
+    GraphLatticeType.tp_init = reinterpret_cast<initproc>(graph_lattice_init);
+
+    ThresholdsType.tp_name = "lattice.Thresholds";
+    ThresholdsType.tp_basicsize = sizeof(ThresholdsObject);
+    ThresholdsType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ThresholdsType.tp_doc = "Thresholds of a run in the order of their realizations";
+    ThresholdsType.tp_dealloc = reinterpret_cast<destructor>(thresholds_dealloc);
+    ThresholdsType.tp_as_buffer = &thresholds_buffer;
+    ThresholdsType.tp_as_sequence = &thresholds_sequence;
+    ThresholdsType.tp_getset = thresholds_getset;
+
+    if (PyType_Ready(&LatticeType_) < 0 || PyType_Ready(&GraphLatticeType) < 0 || PyType_Ready(&ThresholdsType) < 0)
+        return nullptr;
+
+    PyObject *m = PyModule_Create(&module);
+    if (m == nullptr)
+        return nullptr;
+    Py_INCREF(&LatticeType_);
+    Py_INCREF(&GraphLatticeType);
+    PyModule_AddObject(m, "Lattice", reinterpret_cast<PyObject *>(&LatticeType_));
+    PyModule_AddObject(m, "GraphLattice", reinterpret_cast<PyObject *>(&GraphLatticeType));
+    return m;
+}
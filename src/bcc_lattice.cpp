@@ -0,0 +1,23 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include "bcc_lattice.h"
+
+namespace lattice {
+
+BccLattice::BccLattice(size_t size, Storage storage) : VolumetricLattice(size, storage) {
+    create_nodes(stencil());
+}
+
+BccStencil BccLattice::stencil() const {
+    return BccStencil(m_size);
+}
+
+size_t BccLattice::node_count() const {
+    return stencil().node_count();
+}
+
+size_t BccLattice::edge_count() const {
+    return stencil().edge_count();
+}
+
+}
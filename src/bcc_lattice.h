@@ -0,0 +1,23 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_BCC_LATTICE_H
+#define LATTICE_BCC_LATTICE_H
+
+#include "volumetric_lattice.h"
+
+namespace lattice {
+
+class BccLattice : public VolumetricLattice {
+public:
+    explicit BccLattice(size_t size, Storage storage = EXPLICIT);
+
+    size_t node_count() const override;
+
+    size_t edge_count() const override;
+
+    BccStencil stencil() const;
+};
+
+}
+
+#endif //LATTICE_BCC_LATTICE_H
@@ -0,0 +1,303 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include "bit_flood.h"
+
+namespace lattice {
+
+// dst = src shifted by k towards higher columns (up) or lower ones (down), over a row of the given number of words
+static void shift_up(const uint64_t *src, uint64_t *dst, size_t k, size_t words) {
+    const size_t word_shift = k >> 6, bit_shift = k & 63;
+    for (size_t w = words; w-- > 0;) {
+        uint64_t value = 0;
+        if (w >= word_shift) {
+            value = src[w - word_shift] << bit_shift;
+            if (bit_shift != 0 && w > word_shift)
+                value |= src[w - word_shift - 1] >> (64 - bit_shift);
+        }
+        dst[w] = value;
+    }
+}
+
+static void shift_down(const uint64_t *src, uint64_t *dst, size_t k, size_t words) {
+    const size_t word_shift = k >> 6, bit_shift = k & 63;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t value = 0;
+        if (w + word_shift < words) {
+            value = src[w + word_shift] >> bit_shift;
+            if (bit_shift != 0 && w + word_shift + 1 < words)
+                value |= src[w + word_shift + 1] << (64 - bit_shift);
+        }
+        dst[w] = value;
+    }
+}
+
+// 64 bits of the mask starting at bit first, zero past its end
+static uint64_t window(const RemovalMask &mask, size_t first) {
+    const size_t word = first >> 6, shift = first & 63, words = (mask.size() + 63) / 64;
+    if (word >= words)
+        return 0;
+    uint64_t bits = mask.words()[word] >> shift;
+    if (shift != 0 && word + 1 < words)
+        bits |= mask.words()[word + 1] << (64 - shift);
+    return bits;
+}
+
+// Gathers the even bits of x into its lower half
+static uint64_t even_bits(uint64_t x) {
+    x &= 0x5555555555555555ULL;
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x >> 4)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x >> 8)) & 0x0000ffff0000ffffULL;
+    return (x | (x >> 16)) & 0x00000000ffffffffULL;
+}
+
+static uint64_t columns_below(size_t count) {
+    return count >= 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+}
+
+static uint64_t reverse_bits(uint64_t x) {
+    x = __builtin_bswap64(x);
+    x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    return ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+}
+
+// Column j of a row of the given number of words goes to column 64 * words - 1 - j
+static void reverse(const uint64_t *src, uint64_t *dst, size_t words) {
+    for (size_t w = 0; w < words; ++w)
+        dst[w] = reverse_bits(src[words - 1 - w]);
+}
+
+/*
+ * Adds to the wet sites every column reachable from them going up through open bonds. Column j is reached iff j - 1
+ * is reached and its bond is open, which is the carry into bit j of bonds + (wet & bonds): wet sites with an open
+ * bond generate a carry and the other open bonds propagate it, so a single addition spreads the whole row.
+ */
+static void spread_up(uint64_t *wet, const uint64_t *bonds, size_t words) {
+    unsigned __int128 carry = 0;
+    for (size_t w = 0; w < words; ++w) {
+        const uint64_t generate = wet[w] & bonds[w];
+        const unsigned __int128 sum = carry + bonds[w] + generate;
+        wet[w] |= uint64_t(sum) ^ bonds[w] ^ generate;
+        carry = sum >> 64;
+    }
+}
+
+void BitFlood::reset(size_t size, ThresholdFinder::Mode mode, const RemovalMask &removed) {
+    m_size = size;
+    m_words = (size + 63) / 64;
+    for (auto *rows : {&m_occupied, &m_horizontal, &m_horizontal_mirrored, &m_straight, &m_diagonal, &m_wet})
+        rows->assign(size * m_words, 0);
+    m_mask.resize(m_words);
+    m_shifted.resize(m_words);
+    m_incoming.resize(m_words);
+
+    // Sites of row i are bits i * size ... i * size + size - 1 of the mask in the NODES mode, all present otherwise
+    for (size_t i = 0; i < size; ++i) {
+        uint64_t *occupied = row(m_occupied, i);
+        for (size_t w = 0; w < m_words; ++w) {
+            const uint64_t present = mode == ThresholdFinder::NODES ? ~window(removed, i * size + 64 * w) : ~uint64_t(0);
+            occupied[w] = present & columns_below(size - 64 * w);
+        }
+    }
+}
+
+void BitFlood::link_sites(uint64_t horizontal_even, uint64_t horizontal_odd, bool diagonal) {
+    for (size_t i = 0; i < m_size; ++i) {
+        uint64_t *occupied = row(m_occupied, i), *horizontal = row(m_horizontal, i), *shifted = m_shifted.data();
+        const uint64_t pattern = i % 2 == 0 ? horizontal_even : horizontal_odd;
+
+        shift_down(occupied, shifted, 1, m_words);
+        for (size_t w = 0; w < m_words; ++w)
+            horizontal[w] = occupied[w] & shifted[w] & pattern;
+
+        if (i + 1 == m_size)
+            break;
+        uint64_t *below = row(m_occupied, i + 1), *straight = row(m_straight, i);
+        for (size_t w = 0; w < m_words; ++w)
+            straight[w] = occupied[w] & below[w];
+
+        if (!diagonal)
+            continue;
+        uint64_t *diagonals = row(m_diagonal, i);
+        if (i % 2 == 0)
+            shift_up(below, shifted, 1, m_words);
+        else
+            shift_down(below, shifted, 1, m_words);
+        for (size_t w = 0; w < m_words; ++w)
+            diagonals[w] = occupied[w] & shifted[w];
+    }
+}
+
+bool BitFlood::spans(const SquareStencil &stencil, ThresholdFinder::Mode mode, const RemovalMask &removed) {
+    const size_t size = stencil.size();
+    reset(size, mode, removed);
+    if (mode == ThresholdFinder::NODES) {
+        link_sites(~uint64_t(0), ~uint64_t(0), false);
+        return flood();
+    }
+
+    // Rows but the last one interleave bottom and right edges, so 128 bits of the mask give 64 columns of each
+    for (size_t i = 0; i + 1 < size; ++i) {
+        uint64_t *straight = row(m_straight, i), *horizontal = row(m_horizontal, i);
+        for (size_t w = 0; w < m_words; ++w) {
+            const size_t first = stencil.bottom(i, 64 * w);
+            const uint64_t low = window(removed, first), high = window(removed, first + 64);
+            straight[w] = ~(even_bits(low) | even_bits(high) << 32) & columns_below(size - 64 * w);
+            horizontal[w] = ~(even_bits(low >> 1) | even_bits(high >> 1) << 32) & columns_below(size - 1 - 64 * w);
+        }
+    }
+
+    uint64_t *horizontal = row(m_horizontal, size - 1);
+    for (size_t w = 0; w < m_words && size > 1; ++w)
+        horizontal[w] = ~window(removed, stencil.right(size - 1, 64 * w)) & columns_below(size - 1 - 64 * w);
+    return flood();
+}
+
+bool BitFlood::spans(const TriangularStencil &stencil, ThresholdFinder::Mode mode, const RemovalMask &removed) {
+    const size_t size = stencil.size();
+    reset(size, mode, removed);
+    if (mode == ThresholdFinder::NODES) {
+        link_sites(~uint64_t(0), ~uint64_t(0), true);
+        return flood();
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        const bool even = i % 2 == 0;
+        for (size_t j = 0; j < size; ++j) {
+            if (i + 1 < size) {
+                // Down-right leads straight down from even rows and down-left from odd ones, both always exist
+                set(m_straight, i, j, !removed.test(even ? stencil.down_right(i, j) : stencil.down_left(i, j)));
+                if (even ? j > 0 : j + 1 < size)
+                    set(m_diagonal, i, j, !removed.test(even ? stencil.down_left(i, j) : stencil.down_right(i, j)));
+            }
+            if (j + 1 < size)
+                set(m_horizontal, i, j, !removed.test(stencil.right(i, j)));
+        }
+    }
+    return flood();
+}
+
+bool BitFlood::spans(const HexagonalStencil &stencil, ThresholdFinder::Mode mode, const RemovalMask &removed) {
+    const size_t size = stencil.size();
+    reset(size, mode, removed);
+    // Only the sites with i % 2 == j % 2 have a bond to the right
+    const uint64_t even_columns = 0x5555555555555555ULL, odd_columns = ~even_columns;
+    if (mode == ThresholdFinder::NODES) {
+        link_sites(even_columns, odd_columns, false);
+        return flood();
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        for (size_t j = 0; j < size; ++j) {
+            if (i + 1 < size)
+                set(m_straight, i, j, !removed.test(stencil.down(i, j)));
+            if (j + 1 < size && i % 2 == j % 2)
+                set(m_horizontal, i, j, !removed.test(stencil.right(i, j)));
+        }
+    }
+    return flood();
+}
+
+bool BitFlood::flood() {
+    // A single row is only a SOURCE one
+    if (m_size < 2)
+        return false;
+
+    // Mirroring turns the bond from column j to j + 1 into the one from 64 * words - 2 - j to the next column
+    for (size_t i = 0; i < m_size; ++i) {
+        reverse(row(m_horizontal, i), m_shifted.data(), m_words);
+        shift_down(m_shifted.data(), row(m_horizontal_mirrored, i), 1, m_words);
+    }
+
+    uint64_t *first = row(m_wet, 0);
+    const uint64_t *sources = row(m_occupied, 0);
+    for (size_t w = 0; w < m_words; ++w)
+        first[w] = sources[w];
+    fill(0);
+
+    // Rows whose neighbours grew since they were last looked at. Taking the latest one first heads for the target
+    // like a DFS, while near the threshold, where the front winds up and down, only the rows it reaches are redone.
+    m_queued.assign(m_size, 0);
+    m_pending.clear();
+    auto push = [&](size_t i) {
+        if (!m_queued[i]) {
+            m_queued[i] = 1;
+            m_pending.push_back(i);
+        }
+    };
+
+    push(1);
+    while (!m_pending.empty()) {
+        const size_t i = m_pending.back();
+        m_pending.pop_back();
+        m_queued[i] = 0;
+
+        bool grew = false;
+        if (i > 0)
+            grew = pull(i, i - 1);
+        if (i + 1 < m_size)
+            grew = pull(i, i + 1) || grew;
+        if (!grew)
+            continue;
+
+        fill(i);
+        if (i + 1 == m_size)
+            return true;
+        if (i > 0)
+            push(i - 1);
+        push(i + 1);
+    }
+    return false;
+}
+
+bool BitFlood::pull(size_t i, size_t from) {
+    uint64_t *wet = row(m_wet, i), *incoming = m_incoming.data(), *shifted = m_shifted.data();
+    const uint64_t *front = row(m_wet, from);
+
+    // Bonds between rows r and r + 1 are stored in row r
+    const size_t r = from < i ? from : i;
+    const uint64_t *straight = row(m_straight, r), *diagonal = row(m_diagonal, r);
+    const bool even = r % 2 == 0;
+
+    if (from < i) {
+        for (size_t w = 0; w < m_words; ++w)
+            incoming[w] = front[w] & diagonal[w];
+        // From (r, j) the diagonal bond leads to column j - 1 in even rows and to j + 1 in odd ones
+        if (even)
+            shift_down(incoming, shifted, 1, m_words);
+        else
+            shift_up(incoming, shifted, 1, m_words);
+        for (size_t w = 0; w < m_words; ++w)
+            incoming[w] = (front[w] & straight[w]) | shifted[w];
+    } else {
+        if (even)
+            shift_up(front, shifted, 1, m_words);
+        else
+            shift_down(front, shifted, 1, m_words);
+        for (size_t w = 0; w < m_words; ++w)
+            incoming[w] = (front[w] & straight[w]) | (shifted[w] & diagonal[w]);
+    }
+
+    bool grew = false;
+    for (size_t w = 0; w < m_words; ++w) {
+        grew = grew || (incoming[w] & ~wet[w]) != 0;
+        wet[w] |= incoming[w];
+    }
+    return grew;
+}
+
+void BitFlood::fill(size_t i) {
+    uint64_t *wet = row(m_wet, i), *reversed = m_mask.data();
+
+    // Spreading towards higher columns is a carry chain, towards lower ones the same chain on the mirrored row
+    spread_up(wet, row(m_horizontal, i), m_words);
+    reverse(wet, reversed, m_words);
+    spread_up(reversed, row(m_horizontal_mirrored, i), m_words);
+    reverse(reversed, m_shifted.data(), m_words);
+    for (size_t w = 0; w < m_words; ++w)
+        wet[w] |= m_shifted[w];
+}
+
+}
@@ -0,0 +1,67 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_BIT_FLOOD_H
+#define LATTICE_BIT_FLOOD_H
+
+#include <cstdint>
+#include <vector>
+#include "removal_mask.h"
+#include "stencil.h"
+#include "threshold_finder.h"
+
+namespace lattice {
+
+/*
+ * Spanning check for the planar stencils which works on whole rows of 64 sites per word. Open bonds are laid out as
+ * bit rows: horizontal ones, straight down ones and the diagonal down ones of the triangular lattice. The wet front
+ * starts from the SOURCE row and is pulled into the adjacent rows whenever a row grows, each row being filled along
+ * its open horizontal bonds with one carry chain per direction, until nothing changes or the TARGET row gets wet.
+ *
+ * The word loops carry no dependencies between words, so they are vectorized by the compiler where the target allows.
+ */
+class BitFlood {
+public:
+    bool spans(const SquareStencil &stencil, ThresholdFinder::Mode mode, const RemovalMask &removed);
+
+    bool spans(const TriangularStencil &stencil, ThresholdFinder::Mode mode, const RemovalMask &removed);
+
+    bool spans(const HexagonalStencil &stencil, ThresholdFinder::Mode mode, const RemovalMask &removed);
+
+private:
+    size_t m_size = 0;
+    size_t m_words = 0;
+    // Bit j of row i stands for site (i, j), or for the bond going right, down or diagonally down from it. Diagonal
+    // bonds lead to column j - 1 from even rows and to column j + 1 from odd ones.
+    std::vector<uint64_t> m_occupied, m_horizontal, m_horizontal_mirrored, m_straight, m_diagonal, m_wet;
+    // Scratch rows
+    std::vector<uint64_t> m_mask, m_shifted, m_incoming;
+    // Rows to be pulled again, see flood()
+    std::vector<size_t> m_pending;
+    std::vector<uint8_t> m_queued;
+
+    void reset(size_t size, ThresholdFinder::Mode mode, const RemovalMask &removed);
+
+    // Bonds between occupied sites, for the NODES mode. Horizontal ones are limited to the columns of the pattern.
+    void link_sites(uint64_t horizontal_even, uint64_t horizontal_odd, bool diagonal);
+
+    bool flood();
+
+    // ORs the front coming into row i from the adjacent row into the row, returns whether it grew. The row isn't
+    // filled, as it is usually pulled from both sides first.
+    bool pull(size_t i, size_t from);
+
+    // Spreads the wet sites of row i along its open horizontal bonds
+    void fill(size_t i);
+
+    uint64_t *row(std::vector<uint64_t> &rows, size_t i) {
+        return rows.data() + i * m_words;
+    }
+
+    void set(std::vector<uint64_t> &rows, size_t i, size_t j, bool value) {
+        row(rows, i)[j >> 6] |= uint64_t(value) << (j & 63);
+    }
+};
+
+}
+
+#endif //LATTICE_BIT_FLOOD_H
@@ -0,0 +1,108 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "checkpoint.h"
+
+namespace lattice {
+
+static const char MAGIC[8] = {'L', 'A', 'T', 'T', 'C', 'K', 'P', '\0'};
+static const uint32_t VERSION = 1;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t mode;
+    uint32_t engine;
+    uint32_t reserved;
+    uint64_t seed;
+    uint64_t nodes;
+    uint64_t edges;
+    uint64_t iterations;
+};
+
+Checkpoint::Checkpoint(std::string path, std::chrono::seconds interval)
+        : m_path(std::move(path)), m_interval(interval),
+          m_last_save(std::chrono::steady_clock::now().time_since_epoch().count()) {
+}
+
+const std::string &Checkpoint::path() const {
+    return m_path;
+}
+
+bool Checkpoint::load(Snapshot &snapshot) const {
+    std::FILE *file = std::fopen(m_path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    struct stat info;
+    if (::fstat(::fileno(file), &info) != 0) {
+        std::fclose(file);
+        throw std::runtime_error("Can't stat " + m_path);
+    }
+    const uint64_t length = static_cast<uint64_t>(info.st_size);
+
+    // Every iteration takes a done flag and a threshold, and the count is checked against the file length before
+    // anything is allocated for it
+    const uint64_t per_iteration = 1 + sizeof(double);
+    CheckpointHeader header;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                 std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+                 (length - sizeof(header)) % per_iteration == 0 &&
+                 header.iterations == (length - sizeof(header)) / per_iteration;
+    if (valid) {
+        snapshot.mode = header.mode;
+        snapshot.engine = header.engine;
+        snapshot.seed = header.seed;
+        snapshot.nodes = header.nodes;
+        snapshot.edges = header.edges;
+        snapshot.done.resize(header.iterations);
+        snapshot.thresholds.resize(header.iterations);
+        valid = std::fread(snapshot.done.data(), 1, snapshot.done.size(), file) == snapshot.done.size() &&
+                std::fread(snapshot.thresholds.data(), sizeof(double), snapshot.thresholds.size(), file) ==
+                snapshot.thresholds.size();
+    }
+    std::fclose(file);
+
+    if (!valid)
+        throw std::runtime_error(m_path + " is not a valid checkpoint");
+    return true;
+}
+
+void Checkpoint::save(const Snapshot &snapshot) {
+    m_last_save = std::chrono::steady_clock::now().time_since_epoch().count();
+
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.mode = snapshot.mode;
+    header.engine = snapshot.engine;
+    header.seed = snapshot.seed;
+    header.nodes = snapshot.nodes;
+    header.edges = snapshot.edges;
+    header.iterations = snapshot.thresholds.size();
+
+    std::string temporary = m_path + ".tmp";
+    std::FILE *file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr)
+        throw std::runtime_error("Can't open " + temporary + " for writing");
+
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(snapshot.done.data(), 1, snapshot.done.size(), file) == snapshot.done.size() &&
+                   std::fwrite(snapshot.thresholds.data(), sizeof(double), snapshot.thresholds.size(), file) ==
+                   snapshot.thresholds.size();
+    written = std::fclose(file) == 0 && written;
+
+    if (!written || std::rename(temporary.c_str(), m_path.c_str()) != 0)
+        throw std::runtime_error("Can't write checkpoint " + m_path);
+}
+
+bool Checkpoint::due() const {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    return now - m_last_save.load() >= m_interval.count();
+}
+
+}
@@ -0,0 +1,52 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_CHECKPOINT_H
+#define LATTICE_CHECKPOINT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lattice {
+
+/*
+ * File which keeps the realizations completed so far by a run, so that a killed run can be resumed. Nothing but the
+ * finished thresholds has to be saved: realization i is fully determined by the master seed and i, so the ones which
+ * were in progress are simply run again from the start and give the same values.
+ */
+class Checkpoint {
+public:
+    struct Snapshot {
+        uint32_t mode = 0;
+        uint32_t engine = 0;
+        uint64_t seed = 0;
+        uint64_t nodes = 0;
+        uint64_t edges = 0;
+        std::vector<uint8_t> done;
+        std::vector<double> thresholds;
+    };
+
+    explicit Checkpoint(std::string path, std::chrono::seconds interval = std::chrono::seconds(60));
+
+    const std::string &path() const;
+
+    // Returns false if there's no checkpoint yet, throws std::runtime_error if the file is malformed.
+    bool load(Snapshot &snapshot) const;
+
+    // The snapshot is written next to the checkpoint and renamed over it, so a crash never leaves a partial file.
+    void save(const Snapshot &snapshot);
+
+    // Whether the interval has passed since the last save.
+    bool due() const;
+
+private:
+    std::string m_path;
+    std::chrono::steady_clock::duration m_interval;
+    std::atomic<std::chrono::steady_clock::rep> m_last_save;
+};
+
+}
+
+#endif //LATTICE_CHECKPOINT_H
@@ -0,0 +1,23 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include "cubic_lattice.h"
+
+namespace lattice {
+
+CubicLattice::CubicLattice(size_t size, Storage storage) : VolumetricLattice(size, storage) {
+    create_nodes(stencil());
+}
+
+CubicStencil CubicLattice::stencil() const {
+    return CubicStencil(m_size);
+}
+
+size_t CubicLattice::node_count() const {
+    return stencil().node_count();
+}
+
+size_t CubicLattice::edge_count() const {
+    return stencil().edge_count();
+}
+
+}
@@ -0,0 +1,23 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_CUBIC_LATTICE_H
+#define LATTICE_CUBIC_LATTICE_H
+
+#include "volumetric_lattice.h"
+
+namespace lattice {
+
+class CubicLattice : public VolumetricLattice {
+public:
+    explicit CubicLattice(size_t size, Storage storage = EXPLICIT);
+
+    size_t node_count() const override;
+
+    size_t edge_count() const override;
+
+    CubicStencil stencil() const;
+};
+
+}
+
+#endif //LATTICE_CUBIC_LATTICE_H
@@ -0,0 +1,23 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include "fcc_lattice.h"
+
+namespace lattice {
+
+FccLattice::FccLattice(size_t size, Storage storage) : VolumetricLattice(size, storage) {
+    create_nodes(stencil());
+}
+
+FccStencil FccLattice::stencil() const {
+    return FccStencil(m_size);
+}
+
+size_t FccLattice::node_count() const {
+    return stencil().node_count();
+}
+
+size_t FccLattice::edge_count() const {
+    return stencil().edge_count();
+}
+
+}
@@ -0,0 +1,23 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_FCC_LATTICE_H
+#define LATTICE_FCC_LATTICE_H
+
+#include "volumetric_lattice.h"
+
+namespace lattice {
+
+class FccLattice : public VolumetricLattice {
+public:
+    explicit FccLattice(size_t size, Storage storage = EXPLICIT);
+
+    size_t node_count() const override;
+
+    size_t edge_count() const override;
+
+    FccStencil stencil() const;
+};
+
+}
+
+#endif //LATTICE_FCC_LATTICE_H
@@ -0,0 +1,148 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <set>
+#include <stdexcept>
+#include "finite_size_scaling.h"
+#include "kernel.h"
+
+namespace lattice {
+
+// Sums of the normal equations of y = p + a * x with the given weights
+struct Moments {
+    double s = 0, sx = 0, sxx = 0, sy = 0, sxy = 0;
+
+    void add(double w, double x, double y) {
+        s += w;
+        sx += w * x;
+        sxx += w * x * x;
+        sy += w * y;
+        sxy += w * x * y;
+    }
+
+    double determinant() const {
+        return s * sxx - sx * sx;
+    }
+};
+
+static double scaling_variable(size_t size, double nu) {
+    return std::pow(double(size), -1 / nu);
+}
+
+// Variance of a single threshold, kept away from zero so that degenerate tiny lattices don't get infinite weight
+static double sample_variance(const FiniteSizeScaling::Size &size) {
+    return std::max(size.result.statistics.variance(), 1e-12);
+}
+
+double FiniteSizeScaling::Size::cost() const {
+    return result.thresholds.empty() ? 0 : seconds / result.thresholds.size();
+}
+
+/* static */ FiniteSizeScaling::Fit FiniteSizeScaling::fit(const std::vector<Size> &sizes, double nu) {
+    Moments moments;
+    size_t points = 0;
+    for (const Size &size : sizes) {
+        if (size.result.thresholds.empty())
+            continue;
+        const double w = size.result.thresholds.size() / sample_variance(size);
+        moments.add(w, scaling_variable(size.size, nu), size.result.statistics.mean());
+        ++points;
+    }
+
+    Fit fit;
+    const double determinant = moments.determinant();
+    if (points < 2 || determinant <= 0)
+        return fit;
+
+    fit.threshold = (moments.sxx * moments.sy - moments.sx * moments.sxy) / determinant;
+    fit.amplitude = (moments.s * moments.sxy - moments.sx * moments.sy) / determinant;
+    fit.threshold_error = std::sqrt(moments.sxx / determinant);
+    fit.amplitude_error = std::sqrt(moments.s / determinant);
+    fit.degrees_of_freedom = points - 2;
+
+    for (const Size &size : sizes) {
+        if (size.result.thresholds.empty())
+            continue;
+        const double w = size.result.thresholds.size() / sample_variance(size);
+        const double residual = size.result.statistics.mean() - fit.threshold -
+                                fit.amplitude * scaling_variable(size.size, nu);
+        fit.chi_squared += w * residual * residual;
+    }
+    return fit;
+}
+
+/* static */ FiniteSizeScaling::Result
+FiniteSizeScaling::run(LatticeType type, const std::vector<size_t> &sizes, ThresholdFinder::Mode mode,
+                       const Options &options, ThreadPool &pool, ThresholdFinder::Engine engine, uint64_t seed,
+                       const Callback &on_batch_done) {
+    if (std::set<size_t>(sizes.begin(), sizes.end()).size() < 2)
+        throw std::invalid_argument("Finite-size scaling needs at least two distinct sizes");
+
+    Result final;
+    final.seed = seed;
+    std::vector<std::unique_ptr<Lattice>> lattices;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        lattices.push_back(make_lattice(type, sizes[i], options.storage));
+        final.sizes.emplace_back();
+        final.sizes[i].size = sizes[i];
+        final.sizes[i].result.seed = Random(seed, i)();
+    }
+
+    std::vector<Workspace> workspaces(pool.size());
+    double spent = 0;
+
+    // std::clock counts the CPU time of all the threads of the process, so the budget doesn't depend on their number
+    auto run_batch = [&](size_t i, size_t count) {
+        Size &size = final.sizes[i];
+        const size_t first = size.result.thresholds.size();
+        std::vector<double> thresholds(count);
+
+        const std::clock_t start = std::clock();
+        pool.for_each_index(count, [&](size_t index, size_t worker) {
+            thresholds[index] = ThresholdFinder::find_threshold(*lattices[i], first + index, mode, engine,
+                                                                size.result.seed, workspaces[worker]);
+        });
+        const double seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+
+        size.result.append(ThresholdFinder::Result(thresholds));
+        size.seconds += seconds;
+        spent += seconds;
+
+        final.fit = fit(final.sizes, options.nu);
+        if (on_batch_done)
+            on_batch_done(final);
+    };
+
+    const size_t batch = std::max<size_t>(options.batch, 1);
+    for (size_t i = 0; i < sizes.size(); ++i)
+        run_batch(i, std::max<size_t>(options.pilot, 2));
+
+    while (spent < options.budget_seconds) {
+        // The fitted p_c is sum_i c_i * w_i * y_i, so dVar(p_c)/dw_i = -c_i^2. With w_i = n_i / var_i, one more
+        // realization of size i reduces the variance by c_i^2 / var_i at the cost of cost_i seconds.
+        Moments moments;
+        for (const Size &size : final.sizes)
+            moments.add(size.result.thresholds.size() / sample_variance(size), scaling_variable(size.size, options.nu),
+                        0);
+        const double determinant = moments.determinant();
+
+        size_t best = 0;
+        double best_gain = -1;
+        for (size_t i = 0; i < final.sizes.size(); ++i) {
+            const Size &size = final.sizes[i];
+            const double c = (moments.sxx - scaling_variable(size.size, options.nu) * moments.sx) / determinant;
+            const double gain = c * c / sample_variance(size) / std::max(size.cost(), 1e-9);
+            if (gain > best_gain) {
+                best_gain = gain;
+                best = i;
+            }
+        }
+        run_batch(best, batch);
+    }
+
+    return final;
+}
+
+}
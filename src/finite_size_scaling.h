@@ -0,0 +1,76 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_FINITE_SIZE_SCALING_H
+#define LATTICE_FINITE_SIZE_SCALING_H
+
+#include <functional>
+#include <vector>
+#include "lattice_type.h"
+#include "thread_pool.h"
+#include "threshold_finder.h"
+
+namespace lattice {
+
+/*
+ * Estimates the infinite-size threshold from several lattice sizes within a CPU-time budget. The mean thresholds are
+ * fitted to p_c(L) = p_c + a * L^(-1/nu) by weighted least squares, and every further batch of realizations goes to
+ * the size which reduces the variance of the fitted p_c the most per second of CPU time, judging by the variance and
+ * the cost per realization measured so far.
+ *
+ * Size i draws its realizations 0, 1, 2, ... from the i-th stream of the master seed, like the entries of a Sweep, so
+ * the thresholds of a size can be reproduced with ThresholdFinder::run. The allocation itself depends on the timings
+ * and therefore isn't reproducible.
+ */
+class FiniteSizeScaling {
+public:
+    struct Options {
+        // Correlation length exponent, 4/3 for every two-dimensional lattice and about 0.876 in three dimensions
+        double nu = 4.0 / 3;
+        // CPU seconds of all the threads together, checked between batches
+        double budget_seconds = 60;
+        // Realizations of every size before the allocation starts, the variance estimate needs a few dozen of them
+        size_t pilot = 64;
+        size_t batch = 64;
+        Lattice::Storage storage = Lattice::EXPLICIT;
+    };
+
+    struct Size {
+        size_t size = 0;
+        ThresholdFinder::Result result;
+        double seconds = 0;
+
+        double cost() const;
+    };
+
+    struct Fit {
+        double threshold = 0;
+        double threshold_error = 0;
+        double amplitude = 0;
+        double amplitude_error = 0;
+        // Of the fit with the given nu, compare to degrees_of_freedom to see whether the form fits the sizes at all
+        double chi_squared = 0;
+        size_t degrees_of_freedom = 0;
+    };
+
+    struct Result {
+        std::vector<Size> sizes;
+        Fit fit;
+        uint64_t seed = 0;
+    };
+
+    // Called from the calling thread after every batch, e.g. to report progress.
+    using Callback = std::function<void(const Result &result)>;
+
+    // Throws std::invalid_argument for less than two distinct sizes.
+    static Result run(LatticeType type, const std::vector<size_t> &sizes, ThresholdFinder::Mode mode,
+                      const Options &options, ThreadPool &pool,
+                      ThresholdFinder::Engine engine = ThresholdFinder::DROP_AND_DFS,
+                      uint64_t seed = Random::entropy_seed(), const Callback &on_batch_done = nullptr);
+
+    // Weighted least squares fit of the mean thresholds, each weighted by its inverse squared standard error.
+    static Fit fit(const std::vector<Size> &sizes, double nu);
+};
+
+}
+
+#endif //LATTICE_FINITE_SIZE_SCALING_H
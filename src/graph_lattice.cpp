@@ -0,0 +1,350 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "graph_lattice.h"
+
+namespace lattice {
+
+static const char MAGIC[8] = {'L', 'A', 'T', 'T', 'G', 'R', 'F', '\0'};
+static const uint32_t VERSION = 1;
+
+struct GraphHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t nodes;
+    uint64_t edges;
+    uint64_t sources;
+    uint64_t arcs;
+    uint64_t reserved_tail[2];
+};
+
+static_assert(sizeof(GraphHeader) == 64, "GraphHeader layout must not depend on the compiler");
+
+static size_t aligned(size_t bytes) {
+    return (bytes + 7) / 8 * 8;
+}
+
+// Byte offsets of the sections following the header, the last one being the expected file length
+struct GraphLayout {
+    size_t types, sources, offsets, arcs, edges, end;
+
+    explicit GraphLayout(const GraphHeader &header) {
+        types = sizeof(GraphHeader);
+        sources = types + aligned(header.nodes);
+        offsets = sources + aligned(header.sources * sizeof(uint32_t));
+        arcs = offsets + (header.nodes + 1) * sizeof(uint64_t);
+        edges = arcs + header.arcs * sizeof(GraphArc);
+        end = edges + header.edges * sizeof(GraphEdge);
+    }
+};
+
+// Whether the counts of the header describe a file of exactly the given length. Counts are bounded by the length
+// before the layout is computed, so that its sums can't wrap around and match by accident.
+static bool fits(const GraphHeader &header, size_t length) {
+    const uint64_t max_id = std::numeric_limits<uint32_t>::max();
+    if (header.nodes > max_id || header.edges > max_id || header.sources > length / sizeof(uint32_t) ||
+        header.arcs > length / sizeof(GraphArc))
+        return false;
+    return GraphLayout(header).end == length;
+}
+
+// Range checks of every id, offset and type in a single pass, so that the topology can trust the file afterwards
+static bool consistent(const GraphHeader &header, const char *bytes) {
+    GraphLayout layout(header);
+    auto types = reinterpret_cast<const uint8_t *>(bytes + layout.types);
+    auto sources = reinterpret_cast<const uint32_t *>(bytes + layout.sources);
+    auto offsets = reinterpret_cast<const uint64_t *>(bytes + layout.offsets);
+    auto arcs = reinterpret_cast<const GraphArc *>(bytes + layout.arcs);
+    auto edges = reinterpret_cast<const GraphEdge *>(bytes + layout.edges);
+
+    for (uint64_t i = 0; i < header.sources; ++i)
+        if (sources[i] >= header.nodes)
+            return false;
+    for (uint64_t i = 0; i < header.edges; ++i)
+        if (edges[i].node_a >= header.nodes || edges[i].node_b >= header.nodes)
+            return false;
+
+    if (offsets[0] != 0 || offsets[header.nodes] != header.arcs)
+        return false;
+    for (uint64_t node = 0; node < header.nodes; ++node) {
+        if (types[node] > Node::Type::TARGET || offsets[node] > offsets[node + 1] || offsets[node + 1] > header.arcs)
+            return false;
+        // Every arc has to be an edge between the node and the node it leads to
+        for (uint64_t i = offsets[node]; i < offsets[node + 1]; ++i) {
+            if (arcs[i].node >= header.nodes || arcs[i].edge >= header.edges)
+                return false;
+            const GraphEdge &edge = edges[arcs[i].edge];
+            if (!(edge.node_a == node && edge.node_b == arcs[i].node) &&
+                !(edge.node_b == node && edge.node_a == arcs[i].node))
+                return false;
+        }
+    }
+    return true;
+}
+
+static void write_file(const std::string &path, const std::vector<uint8_t> &types, const std::vector<uint32_t> &sources,
+                       const std::vector<uint64_t> &offsets, const std::vector<GraphArc> &arcs,
+                       const std::vector<GraphEdge> &edges) {
+    GraphHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.nodes = types.size();
+    header.edges = edges.size();
+    header.sources = sources.size();
+    header.arcs = arcs.size();
+
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        throw std::runtime_error("Can't open " + path + " for writing");
+
+    const uint64_t zeros = 0;
+    auto section = [&](const void *data, size_t bytes) {
+        return std::fwrite(data, 1, bytes, file) == bytes &&
+               std::fwrite(&zeros, 1, aligned(bytes) - bytes, file) == aligned(bytes) - bytes;
+    };
+    bool written = section(&header, sizeof(header)) &&
+                   section(types.data(), types.size()) &&
+                   section(sources.data(), sources.size() * sizeof(uint32_t)) &&
+                   section(offsets.data(), offsets.size() * sizeof(uint64_t)) &&
+                   section(arcs.data(), arcs.size() * sizeof(GraphArc)) &&
+                   section(edges.data(), edges.size() * sizeof(GraphEdge));
+    written = std::fclose(file) == 0 && written;
+    if (!written)
+        throw std::runtime_error("Can't write " + path);
+}
+
+static std::vector<uint8_t> node_types(size_t node_count, const std::vector<size_t> &sources,
+                                       const std::vector<size_t> &targets) {
+    std::vector<uint8_t> types(node_count, Node::Type::INTERMEDIATE);
+    for (size_t node : sources)
+        types.at(node) = Node::Type::SOURCE;
+    for (size_t node : targets)
+        types.at(node) = Node::Type::TARGET;
+    return types;
+}
+
+GraphLattice::GraphLattice(const std::string &path)
+        : m_data(nullptr), m_length(0), m_topology(0, 0, nullptr, nullptr, 0, nullptr, nullptr, nullptr) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Can't open " + path);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Can't stat " + path);
+    }
+    m_length = static_cast<size_t>(info.st_size);
+
+    if (m_length > 0) {
+        m_data = ::mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        if (m_data == MAP_FAILED) {
+            m_data = nullptr;
+            ::close(fd);
+            throw std::runtime_error("Can't map " + path);
+        }
+    }
+    ::close(fd);
+
+    auto bytes = static_cast<const char *>(m_data);
+    auto header = reinterpret_cast<const GraphHeader *>(bytes);
+    if (m_length < sizeof(GraphHeader) || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->version != VERSION) {
+        unmap();
+        throw std::runtime_error(path + " is not a graph file");
+    }
+
+    if (!fits(*header, m_length)) {
+        unmap();
+        throw std::runtime_error(path + " is truncated");
+    }
+    if (!consistent(*header, bytes)) {
+        unmap();
+        throw std::runtime_error(path + " is malformed");
+    }
+
+    GraphLayout layout(*header);
+    auto offsets = reinterpret_cast<const uint64_t *>(bytes + layout.offsets);
+
+    m_topology = GraphTopology(header->nodes, header->edges, reinterpret_cast<const uint8_t *>(bytes + layout.types),
+                               reinterpret_cast<const uint32_t *>(bytes + layout.sources), header->sources, offsets,
+                               reinterpret_cast<const GraphArc *>(bytes + layout.arcs),
+                               reinterpret_cast<const GraphEdge *>(bytes + layout.edges));
+}
+
+GraphLattice::~GraphLattice() {
+    unmap();
+}
+
+void GraphLattice::unmap() {
+    if (m_data != nullptr)
+        ::munmap(m_data, m_length);
+    m_data = nullptr;
+}
+
+const std::vector<Edge> &GraphLattice::edges() const {
+    throw std::logic_error("A graph lattice has no edge table, use topology()");
+}
+
+const std::vector<Node> &GraphLattice::nodes() const {
+    throw std::logic_error("A graph lattice has no node table, use topology()");
+}
+
+std::vector<size_t> GraphLattice::source_idx() const {
+    return m_topology.sources();
+}
+
+void GraphLattice::drop_node(size_t) {
+    throw std::logic_error("A graph lattice is read-only");
+}
+
+void GraphLattice::drop_edge_between(size_t, size_t) {
+    throw std::logic_error("A graph lattice is read-only");
+}
+
+size_t GraphLattice::node_count() const {
+    return m_topology.node_count();
+}
+
+size_t GraphLattice::edge_count() const {
+    return m_topology.edge_count();
+}
+
+GraphTopology GraphLattice::topology() const {
+    return m_topology;
+}
+
+/* static */ void GraphLattice::write(const std::string &path, size_t node_count, const std::vector<size_t> &sources,
+                                      const std::vector<size_t> &targets, const std::vector<Edge> &edges) {
+    if (node_count > std::numeric_limits<uint32_t>::max() || edges.size() > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("Graph files are limited to 2^32 nodes and edges");
+
+    std::vector<uint32_t> source_ids(sources.begin(), sources.end());
+    std::vector<uint64_t> offsets(node_count + 1, 0);
+    std::vector<GraphEdge> edge_list;
+    edge_list.reserve(edges.size());
+    for (const Edge &edge : edges) {
+        if (edge.node_a >= node_count || edge.node_b >= node_count)
+            throw std::invalid_argument("Edge endpoint out of range");
+        edge_list.push_back({uint32_t(edge.node_a), uint32_t(edge.node_b)});
+        ++offsets[edge.node_a + 1];
+        ++offsets[edge.node_b + 1];
+    }
+    for (size_t node = 0; node < node_count; ++node)
+        offsets[node + 1] += offsets[node];
+
+    // Counting sort of both directions of every edge by their first node, which keeps the edge order in every list
+    std::vector<GraphArc> arcs(2 * edges.size());
+    std::vector<uint64_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t id = 0; id < edge_list.size(); ++id) {
+        arcs[next[edge_list[id].node_a]++] = {edge_list[id].node_b, uint32_t(id)};
+        arcs[next[edge_list[id].node_b]++] = {edge_list[id].node_a, uint32_t(id)};
+    }
+
+    write_file(path, node_types(node_count, sources, targets), source_ids, offsets, arcs, edge_list);
+}
+
+/* static */ void GraphLattice::write(const std::string &path, const Lattice &lattice) {
+    const std::vector<Node> &nodes = lattice.nodes();
+    const std::vector<Edge> &edges = lattice.edges();
+    if (nodes.size() > std::numeric_limits<uint32_t>::max() || edges.size() > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("Graph files are limited to 2^32 nodes and edges");
+
+    std::vector<uint8_t> types(nodes.size());
+    std::vector<uint64_t> offsets(nodes.size() + 1, 0);
+    std::vector<GraphArc> arcs;
+    arcs.reserve(2 * edges.size());
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        types[node] = nodes[node].type;
+        for (size_t edge : nodes[node].edges) {
+            size_t another_node = edges[edge].node_a == node ? edges[edge].node_b : edges[edge].node_a;
+            arcs.push_back({uint32_t(another_node), uint32_t(edge)});
+        }
+        offsets[node + 1] = arcs.size();
+    }
+
+    std::vector<size_t> sources = lattice.source_idx();
+    std::vector<GraphEdge> edge_list;
+    edge_list.reserve(edges.size());
+    for (const Edge &edge : edges)
+        edge_list.push_back({uint32_t(edge.node_a), uint32_t(edge.node_b)});
+
+    write_file(path, types, std::vector<uint32_t>(sources.begin(), sources.end()), offsets, arcs, edge_list);
+}
+
+/* static */ std::vector<size_t> GraphLattice::edge_ids(const Lattice &lattice, const std::vector<size_t> &new_ids) {
+    const std::vector<Edge> &edges = lattice.edges();
+
+    // Edges sorted by their lower and then their higher endpoint in the new numbering, ties kept in the old order
+    auto renamed = [&](size_t edge) {
+        const size_t a = new_ids.at(edges[edge].node_a), b = new_ids.at(edges[edge].node_b);
+        return std::make_tuple(std::min(a, b), std::max(a, b), edge);
+    };
+    std::vector<size_t> edge_order(edges.size());
+    std::iota(edge_order.begin(), edge_order.end(), 0);
+    std::sort(edge_order.begin(), edge_order.end(), [&](size_t a, size_t b) { return renamed(a) < renamed(b); });
+
+    std::vector<size_t> new_edge_ids(edges.size());
+    for (size_t position = 0; position < edge_order.size(); ++position)
+        new_edge_ids[edge_order[position]] = position;
+    return new_edge_ids;
+}
+
+/* static */ void GraphLattice::write(const std::string &path, const Lattice &lattice,
+                                      const std::vector<size_t> &new_ids) {
+    const std::vector<Node> &nodes = lattice.nodes();
+    const std::vector<Edge> &edges = lattice.edges();
+    if (nodes.size() > std::numeric_limits<uint32_t>::max() || edges.size() > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("Graph files are limited to 2^32 nodes and edges");
+    if (new_ids.size() != nodes.size())
+        throw std::invalid_argument("Every node needs a new id");
+
+    std::vector<size_t> old_ids(nodes.size(), nodes.size());
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        if (new_ids[node] >= nodes.size() || old_ids[new_ids[node]] != nodes.size())
+            throw std::invalid_argument("New node ids must be a permutation");
+        old_ids[new_ids[node]] = node;
+    }
+
+    const std::vector<size_t> new_edge_ids = edge_ids(lattice, new_ids);
+    std::vector<GraphEdge> edge_list(edges.size());
+    for (size_t edge = 0; edge < edges.size(); ++edge) {
+        const size_t a = new_ids[edges[edge].node_a], b = new_ids[edges[edge].node_b];
+        edge_list[new_edge_ids[edge]] = {uint32_t(std::min(a, b)), uint32_t(std::max(a, b))};
+    }
+
+    std::vector<uint8_t> types(nodes.size());
+    std::vector<uint64_t> offsets(nodes.size() + 1, 0);
+    std::vector<GraphArc> arcs;
+    arcs.reserve(2 * edges.size());
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        const Node &old = nodes[old_ids[node]];
+        types[node] = old.type;
+        for (size_t edge : old.edges) {
+            size_t another_node = edges[edge].node_a == old_ids[node] ? edges[edge].node_b : edges[edge].node_a;
+            arcs.push_back({uint32_t(new_ids[another_node]), uint32_t(new_edge_ids[edge])});
+        }
+        offsets[node + 1] = arcs.size();
+    }
+
+    std::vector<uint32_t> sources;
+    for (size_t node : lattice.source_idx())
+        sources.push_back(uint32_t(new_ids[node]));
+    std::sort(sources.begin(), sources.end());
+
+    write_file(path, types, sources, offsets, arcs, edge_list);
+}
+
+}
@@ -0,0 +1,133 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_GRAPH_LATTICE_H
+#define LATTICE_GRAPH_LATTICE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "lattice.h"
+
+namespace lattice {
+
+// One entry of a node's adjacency: the node across an edge and the id of that edge
+struct GraphArc {
+    uint32_t node;
+    uint32_t edge;
+};
+
+// Edge as stored in a graph file
+struct GraphEdge {
+    uint32_t node_a;
+    uint32_t node_b;
+};
+
+/*
+ * Read-only view of the compressed sparse row adjacency of a GraphLattice, with the same interface as the stencils
+ * (see stencil.h), so that the kernels run on it directly.
+ */
+class GraphTopology {
+public:
+    GraphTopology(size_t nodes, size_t edges, const uint8_t *types, const uint32_t *sources, size_t source_count,
+                  const uint64_t *offsets, const GraphArc *arcs, const GraphEdge *edge_list)
+            : m_nodes(nodes), m_edges(edges), m_types(types), m_sources(sources), m_source_count(source_count),
+              m_offsets(offsets), m_arcs(arcs), m_edge_list(edge_list) {}
+
+    size_t node_count() const {
+        return m_nodes;
+    }
+
+    size_t edge_count() const {
+        return m_edges;
+    }
+
+    Node::Type type(size_t node) const {
+        return static_cast<Node::Type>(m_types[node]);
+    }
+
+    Edge endpoints(size_t edge) const {
+        return Edge{m_edge_list[edge].node_a, m_edge_list[edge].node_b};
+    }
+
+    std::vector<size_t> sources() const {
+        return std::vector<size_t>(m_sources, m_sources + m_source_count);
+    }
+
+    template<class F>
+    void for_each_neighbor(size_t node, F &&f) const {
+        for (uint64_t i = m_offsets[node]; i < m_offsets[node + 1]; ++i)
+            f(m_arcs[i].node, m_arcs[i].edge);
+    }
+
+private:
+    size_t m_nodes;
+    size_t m_edges;
+    const uint8_t *m_types;
+    const uint32_t *m_sources;
+    size_t m_source_count;
+    const uint64_t *m_offsets;
+    const GraphArc *m_arcs;
+    const GraphEdge *m_edge_list;
+};
+
+/*
+ * Arbitrary graph memory-mapped from a file written by GraphLattice::write(). The file holds a header followed by
+ * the node types (uint8), the source ids (uint32), the CSR offsets (uint64, one per node plus one), the adjacency
+ * lists (GraphArc) and the edges (GraphEdge), every section 8-byte aligned and in the native byte order.
+ *
+ * Nothing is copied on load, so the graph is shared by all the workers and by all the processes mapping the same file.
+ * As with implicit lattices, the topology is only available through topology(): nodes(), edges() and the drop
+ * methods throw std::logic_error. Throws std::runtime_error if the file can't be mapped or is malformed.
+ */
+class GraphLattice : public Lattice {
+public:
+    explicit GraphLattice(const std::string &path);
+
+    ~GraphLattice() override;
+
+    GraphLattice(const GraphLattice &) = delete;
+
+    GraphLattice &operator=(const GraphLattice &) = delete;
+
+    const std::vector<Edge> &edges() const override;
+
+    const std::vector<Node> &nodes() const override;
+
+    std::vector<size_t> source_idx() const override;
+
+    void drop_node(size_t node_id) override;
+
+    void drop_edge_between(size_t node_a, size_t node_b) override;
+
+    size_t node_count() const override;
+
+    size_t edge_count() const override;
+
+    GraphTopology topology() const;
+
+    // Writes a graph file. Adjacency lists follow the order of the edge ids. Nodes not listed are INTERMEDIATE.
+    static void write(const std::string &path, size_t node_count, const std::vector<size_t> &sources,
+                      const std::vector<size_t> &targets, const std::vector<Edge> &edges);
+
+    // Writes an explicit lattice as a graph file, keeping its node and edge ids and the order of its adjacency lists,
+    // so that the loaded graph gives exactly the same thresholds. Dropped edges and nodes stay dropped.
+    static void write(const std::string &path, const Lattice &lattice);
+
+    // Writes an explicit lattice with node i renumbered to new_ids[i], e.g. along a curve given by node_order(). Edges
+    // are renumbered by their endpoints in the new order, so that the ones of nearby nodes are stored nearby as well.
+    static void write(const std::string &path, const Lattice &lattice, const std::vector<size_t> &new_ids);
+
+    // New id of every edge of the lattice in the file written by the overload above with the same new_ids
+    static std::vector<size_t> edge_ids(const Lattice &lattice, const std::vector<size_t> &new_ids);
+
+private:
+    void *m_data;
+    size_t m_length;
+    GraphTopology m_topology;
+
+    void unmap();
+};
+
+}
+
+#endif //LATTICE_GRAPH_LATTICE_H
@@ -2,11 +2,13 @@
 
 #include "hexagonal_lattice.h"
 #include <numeric>
+#include <stdexcept>
 
 namespace lattice {
 
-HexagonalLattice::HexagonalLattice(size_t size) : m_size(size) {
-    create_nodes();
+HexagonalLattice::HexagonalLattice(size_t size, Storage storage) : m_size(size), m_storage(storage) {
+    if (m_storage == EXPLICIT)
+        create_nodes();
 }
 
 void HexagonalLattice::create_nodes() {
@@ -72,10 +74,12 @@ void HexagonalLattice::create_nodes() {
 }
 
 const std::vector<Edge> &HexagonalLattice::edges() const {
+    require_tables();
     return this->m_edges;
 }
 
 const std::vector<Node> &HexagonalLattice::nodes() const {
+    require_tables();
     return this->m_nodes;
 }
 
@@ -85,11 +89,29 @@ std::vector<size_t> HexagonalLattice::source_idx() const {
     return idx;
 }
 
+HexagonalStencil HexagonalLattice::stencil() const {
+    return HexagonalStencil(m_size);
+}
+
+size_t HexagonalLattice::node_count() const {
+    return stencil().node_count();
+}
+
+size_t HexagonalLattice::edge_count() const {
+    return stencil().edge_count();
+}
+
+void HexagonalLattice::require_tables() const {
+    if (m_storage == IMPLICIT)
+        throw std::logic_error("An implicit lattice has no node and edge tables");
+}
+
 void HexagonalLattice::drop_node(size_t node_id) {
+    require_tables();
     Node &node = m_nodes[node_id];
 
     for (auto &edge : node.edges) {
-        size_t adj_node_id = m_edges[edge].node_b == node_id ? m_edges[edge].node_b : m_edges[edge].node_a;
+        size_t adj_node_id = m_edges[edge].node_b == node_id ? m_edges[edge].node_a : m_edges[edge].node_b;
 
         Node &adj_node = m_nodes[adj_node_id];
         size_t i;
@@ -104,6 +126,7 @@ void HexagonalLattice::drop_node(size_t node_id) {
 }
 
 void HexagonalLattice::drop_edge_between(size_t n1, size_t n2) {
+    require_tables();
     Node &node1 = m_nodes[n1], &node2 = m_nodes[n2];
     size_t i;
 
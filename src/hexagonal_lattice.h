@@ -4,12 +4,13 @@
 #define LATTICE_HEXAGONAL_LATTICE_H
 
 #include "lattice.h"
+#include "stencil.h"
 
 namespace lattice {
 
 class HexagonalLattice : public Lattice {
 public:
-    explicit HexagonalLattice(size_t size);
+    explicit HexagonalLattice(size_t size, Storage storage = EXPLICIT);
 
     const std::vector<Edge> &edges() const override;
 
@@ -21,13 +22,23 @@ public:
 
     void drop_edge_between(size_t node_a, size_t node_b) override;
 
+    size_t node_count() const override;
+
+    size_t edge_count() const override;
+
+    // Same topology as the tables above, computed from node and edge ids
+    HexagonalStencil stencil() const;
+
 private:
     size_t m_size;
+    Storage m_storage;
     std::vector<Node> m_nodes;
     std::vector<Edge> m_edges;
 
     void create_nodes();
 
+    void require_tables() const;
+
 };
 
 }
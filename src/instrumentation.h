@@ -0,0 +1,69 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_INSTRUMENTATION_H
+#define LATTICE_INSTRUMENTATION_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace lattice {
+
+/*
+ * Hot-path counters of ThresholdFinder. They are only updated when the library is built with the
+ * LATTICE_INSTRUMENTATION CMake option, otherwise the macros below expand to nothing and the counters stay zero.
+ */
+struct Counters {
+    uint64_t realizations = 0;
+    // Kernel::find_path calls in DROP_AND_DFS and Kernel::spans calls in BISECTION
+    uint64_t is_permeable_calls = 0;
+    // Nodes entered by Kernel::find_path and by the breadth-first Kernel::search; the row floods of the built-in
+    // stencils don't count theirs
+    uint64_t visited_nodes = 0;
+    // Removals in DROP_AND_DFS, each tested against the on_path bits of the cached path
+    uint64_t path_checks = 0;
+    // Building the lattice (generator overload) and resetting the per-realization state
+    double construction_seconds = 0;
+    // Choosing and removing or occupying elements, including the path checks, and rebuilding the mask in BISECTION
+    double removal_seconds = 0;
+    // Kernel::find_path calls in DROP_AND_DFS, Kernel::spans calls in BISECTION, union-find queries in UNION_FIND
+    double connectivity_seconds = 0;
+
+    void merge(const Counters &another) {
+        realizations += another.realizations;
+        is_permeable_calls += another.is_permeable_calls;
+        visited_nodes += another.visited_nodes;
+        path_checks += another.path_checks;
+        construction_seconds += another.construction_seconds;
+        removal_seconds += another.removal_seconds;
+        connectivity_seconds += another.connectivity_seconds;
+    }
+};
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(double &seconds) : m_seconds(seconds), m_start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedTimer() {
+        m_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    double &m_seconds;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+}
+
+#define LATTICE_CONCAT_IMPL(a, b) a##b
+#define LATTICE_CONCAT(a, b) LATTICE_CONCAT_IMPL(a, b)
+
+#ifdef LATTICE_INSTRUMENTATION
+#define LATTICE_COUNT(counter, n) ((counter) += (n))
+#define LATTICE_TIME(seconds) ::lattice::ScopedTimer LATTICE_CONCAT(lattice_timer_, __LINE__)(seconds)
+#else
+// The operands stay unevaluated, they are only mentioned so that disabled counters don't trigger unused warnings
+#define LATTICE_COUNT(counter, n) ((void) sizeof((counter) += (n)))
+#define LATTICE_TIME(seconds) ((void) sizeof(seconds))
+#endif
+
+#endif //LATTICE_INSTRUMENTATION_H
@@ -0,0 +1,170 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <algorithm>
+#include "invasion_percolation.h"
+#include "topology.h"
+
+namespace lattice {
+
+static unsigned lowest_bit(uint64_t word) {
+    return unsigned(__builtin_ctzll(word));
+}
+
+void BucketQueue::reset(unsigned bits) {
+    if (m_shift == 64 - bits) {
+        clear();
+        return;
+    }
+
+    m_shift = 64 - bits;
+    m_buckets.assign(size_t(1) << bits, {});
+    m_levels.clear();
+    size_t bits_in_level = m_buckets.size();
+    do {
+        m_levels.emplace_back((bits_in_level + 63) / 64, 0);
+        bits_in_level = m_levels.back().size();
+    } while (bits_in_level > 1);
+}
+
+void BucketQueue::clear() {
+    // Only the buckets marked in the bitmap can hold anything
+    std::vector<uint64_t> &marked = m_levels[0];
+    for (size_t word = 0; word < marked.size(); ++word)
+        for (uint64_t bits = marked[word]; bits != 0; bits &= bits - 1)
+            m_buckets[word * 64 + lowest_bit(bits)].clear();
+    for (auto &level : m_levels)
+        std::fill(level.begin(), level.end(), 0);
+}
+
+bool BucketQueue::empty() const {
+    return m_levels.back()[0] == 0;
+}
+
+void BucketQueue::push(uint64_t weight, size_t id) {
+    size_t index = m_shift < 64 ? size_t(weight >> m_shift) : 0;
+    m_buckets[index].emplace_back(weight, id);
+    for (auto &level : m_levels) {
+        level[index / 64] |= uint64_t(1) << (index % 64);
+        index /= 64;
+    }
+}
+
+std::pair<uint64_t, size_t> BucketQueue::pop() {
+    size_t index = 0;
+    for (size_t level = m_levels.size(); level-- > 0;)
+        index = index * 64 + lowest_bit(m_levels[level][index]);
+
+    auto &bucket = m_buckets[index];
+    auto lowest = std::min_element(bucket.begin(), bucket.end());
+    const std::pair<uint64_t, size_t> entry = *lowest;
+    *lowest = bucket.back();
+    bucket.pop_back();
+
+    // An emptied bucket is unmarked, and so is every word of the bitmap which becomes zero
+    for (size_t level = 0; level < m_levels.size() && bucket.empty(); ++level) {
+        uint64_t &word = m_levels[level][index / 64];
+        word &= ~(uint64_t(1) << (index % 64));
+        if (word != 0)
+            break;
+        index /= 64;
+    }
+    return entry;
+}
+
+template<class Topology>
+InvasionPercolation::Sample
+InvasionPercolation::invade(const Topology &topology, ThresholdFinder::Mode mode, uint64_t key) {
+    const bool edges = mode == ThresholdFinder::EDGES;
+    const size_t nodes = topology.node_count(), total = edges ? topology.edge_count() : nodes;
+
+    m_boundary.reset(BUCKET_BITS);
+    m_invaded.reset(nodes);
+    m_queued.reset(edges ? 0 : nodes);
+
+    Sample sample;
+    if (total == 0)
+        return sample;
+
+    size_t invaded = 0;
+    uint64_t max_weight = 0;
+    bool reached = false;
+
+    // Invades a node, reporting whether it's a TARGET one, and queues the boundary elements around it
+    auto enter = [&](size_t node) {
+        m_invaded.set(node);
+        if (topology.type(node) == Node::Type::TARGET)
+            return true;
+        topology.for_each_neighbor(node, [&](size_t neighbor, size_t edge) {
+            if (m_invaded.test(neighbor))
+                return;
+            if (edges) {
+                m_boundary.push(Random::hash(key, edge), edge);
+            } else if (!m_queued.test(neighbor)) {
+                m_queued.set(neighbor);
+                m_boundary.push(Random::hash(key, neighbor), neighbor);
+            }
+        });
+        return false;
+    };
+
+    for (size_t source : topology.sources()) {
+        if (edges) {
+            m_invaded.set(source);
+            reached = reached || topology.type(source) == Node::Type::TARGET;
+        } else if (!m_queued.test(source)) {
+            m_queued.set(source);
+            m_boundary.push(Random::hash(key, source), source);
+        }
+    }
+    if (edges && !reached)
+        for (size_t source : topology.sources())
+            enter(source);
+
+    while (!reached && !m_boundary.empty()) {
+        const auto entry = m_boundary.pop();
+        size_t node = entry.second;
+        if (edges) {
+            const Edge ends = topology.endpoints(entry.second);
+            if (m_invaded.test(ends.node_a) && m_invaded.test(ends.node_b))
+                continue;
+            node = m_invaded.test(ends.node_a) ? ends.node_b : ends.node_a;
+        }
+        ++invaded;
+        max_weight = std::max(max_weight, entry.first);
+        reached = enter(node);
+    }
+
+    sample.invaded_fraction = double(invaded) / total;
+    sample.max_weight = (max_weight >> 11) * (1.0 / 9007199254740992.0);
+    return sample;
+}
+
+InvasionPercolation::Sample InvasionPercolation::invade(const Lattice &lattice, ThresholdFinder::Mode mode,
+                                                        Random &rng) {
+    const uint64_t key = rng();
+    return with_topology(lattice, [&](const auto &topology) {
+        return invade(topology, mode, key);
+    });
+}
+
+/* static */ InvasionPercolation::Result
+InvasionPercolation::run(const Lattice &lattice, ThresholdFinder::Mode mode, size_t realizations, ThreadPool &pool,
+                         uint64_t seed) {
+    std::vector<InvasionPercolation> workers(pool.size());
+    Result result;
+    result.seed = seed;
+    result.samples.resize(realizations);
+
+    pool.for_each_index(realizations, [&](size_t index, size_t worker) {
+        Random rng(seed, index);
+        result.samples[index] = workers[worker].invade(lattice, mode, rng);
+    });
+
+    for (const Sample &sample : result.samples) {
+        result.invaded_fraction.add(sample.invaded_fraction);
+        result.max_weight.add(sample.max_weight);
+    }
+    return result;
+}
+
+}
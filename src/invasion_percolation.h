@@ -0,0 +1,91 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_INVASION_PERCOLATION_H
+#define LATTICE_INVASION_PERCOLATION_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "lattice.h"
+#include "random.h"
+#include "removal_mask.h"
+#include "statistics.h"
+#include "thread_pool.h"
+#include "threshold_finder.h"
+
+namespace lattice {
+
+/*
+ * Min-priority queue of 64-bit weights split into 2^bits buckets by their leading bits. A hierarchical bitmap of the
+ * non-empty buckets finds the lowest one in a few word operations, and the lowest weight is then searched for within
+ * that bucket. Unlike a radix heap it doesn't need the popped weights to grow, which invasion doesn't guarantee.
+ */
+class BucketQueue {
+public:
+    void reset(unsigned bits);
+
+    bool empty() const;
+
+    void push(uint64_t weight, size_t id);
+
+    // Removes the lowest weight, the queue must not be empty
+    std::pair<uint64_t, size_t> pop();
+
+private:
+    unsigned m_shift = 64;
+    std::vector<std::vector<std::pair<uint64_t, size_t>>> m_buckets;
+    // Level 0 has a bit per bucket, every next level a bit per word of the previous one, the last level is one word
+    std::vector<std::vector<uint64_t>> m_levels;
+
+    void clear();
+};
+
+/*
+ * Invasion percolation: every edge or node gets a random weight, and the cluster grows from the SOURCE nodes by
+ * always invading the lowest-weight element of its boundary until a TARGET node is invaded. In the EDGES mode the
+ * SOURCE nodes start invaded and bonds to invaded nodes are dropped from the boundary without being counted, in the
+ * NODES mode the SOURCE nodes themselves form the initial boundary.
+ *
+ * Element e has the weight Random::hash(k, e), k being the first output of the realization's generator, so weights are
+ * never stored. If no TARGET node can be reached, everything reachable gets invaded.
+ */
+class InvasionPercolation {
+public:
+    struct Sample {
+        // Invaded elements over all the elements of the lattice
+        double invaded_fraction = 0;
+        // Highest weight invaded, scaled to [0, 1). It approaches the percolation threshold with the size.
+        double max_weight = 0;
+    };
+
+    struct Result {
+        std::vector<Sample> samples;
+        Statistics invaded_fraction;
+        Statistics max_weight;
+        // Master seed of the run, passing it back to run() reproduces the result exactly
+        uint64_t seed = 0;
+    };
+
+    // Buckets of the boundary queue. The invasion front keeps popping weights around the threshold, and the boundary
+    // piles up above it, so a few thousand buckets beat both finer ones, which cost a cache miss per push, and a heap.
+    static const unsigned BUCKET_BITS = 12;
+
+    Sample invade(const Lattice &lattice, ThresholdFinder::Mode mode, Random &rng);
+
+    // Realization i draws from the stream (seed, i), so the result doesn't depend on the number of threads.
+    static Result run(const Lattice &lattice, ThresholdFinder::Mode mode, size_t realizations, ThreadPool &pool,
+                      uint64_t seed = Random::entropy_seed());
+
+private:
+    BucketQueue m_boundary;
+    RemovalMask m_invaded;
+    // Nodes put on the boundary so far in the NODES mode, each of them is queued once
+    RemovalMask m_queued;
+
+    template<class Topology>
+    Sample invade(const Topology &topology, ThresholdFinder::Mode mode, uint64_t key);
+};
+
+}
+
+#endif //LATTICE_INVASION_PERCOLATION_H
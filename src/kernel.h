@@ -0,0 +1,335 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_KERNEL_H
+#define LATTICE_KERNEL_H
+
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+#include "bit_flood.h"
+#include "instrumentation.h"
+#include "lattice.h"
+#include "random.h"
+#include "removal_mask.h"
+#include "stencil.h"
+#include "threshold_finder.h"
+#include "topology.h"
+#include "union_find.h"
+
+namespace lattice {
+
+// Scratch memory reused by all the realizations running on one worker
+struct Workspace {
+    RemovalMask removed;
+    // Nodes occupied so far by the UNION_FIND engine in the NODES mode
+    RemovalMask occupied;
+    std::vector<size_t> order;
+    UnionFind clusters;
+
+    // Last path found by the DFS: its nodes from the target back to the source, and the removable elements (edges or
+    // nodes, depending on the mode) it goes through, so that an interruption is detected with a single bit test.
+    std::vector<size_t> path;
+    RemovalMask on_path;
+
+    // Pending DFS steps: a node together with the node and the edge it was reached from
+    struct Step {
+        size_t node;
+        size_t parent;
+        size_t edge;
+    };
+
+    RemovalMask visited;
+    std::vector<Step> stack;
+    std::vector<Step> neighbors;
+    std::vector<size_t> parent;
+    std::vector<size_t> parent_edge;
+
+    // BFS frontier of the BISECTION engine, which unlike a vector gives memory back as it shrinks
+    std::deque<size_t> frontier;
+    BitFlood flood;
+
+    Counters counters;
+};
+
+/*
+ * All the ThresholdFinder engines, instantiated for a topology (LatticeTopology or one of the stencils), so that for the
+ * built-in lattices neighbours are computed inline instead of going through virtual calls and the tables.
+ */
+template<class Topology>
+class Kernel {
+public:
+    using Mode = ThresholdFinder::Mode;
+
+    static double drop_until_impermeable(const Topology &topology, Mode mode, Random &rng, Workspace &ws) {
+        Counters &counters = ws.counters;
+        const size_t total = mode == Mode::EDGES ? topology.edge_count() : topology.node_count();
+        {
+            LATTICE_TIME(counters.construction_seconds);
+            ws.removed.reset(total);
+            ws.order.resize(total);
+            std::iota(ws.order.begin(), ws.order.end(), 0);
+        }
+
+        size_t dropped_count = 0;
+        bool permeable = find_path(topology, mode, ws.removed, ws);
+        while (permeable && dropped_count < total) {
+            size_t id;
+            bool path_interrupted;
+            {
+                LATTICE_TIME(counters.removal_seconds);
+                // One step of Fisher-Yates: the next element is drawn only among the ones still present
+                std::swap(ws.order[dropped_count], ws.order[dropped_count + rng.below(total - dropped_count)]);
+                id = ws.order[dropped_count++];
+                ws.removed.set(id);
+
+                LATTICE_COUNT(counters.path_checks, 1);
+                path_interrupted = ws.on_path.test(id);
+            }
+
+            if (path_interrupted) {
+                LATTICE_TIME(counters.connectivity_seconds);
+                permeable = find_path(topology, mode, ws.removed, ws);
+            }
+        }
+
+        // Without any elements there is nothing to remove, and the lattice can't be permeable either
+        return total > 0 ? 1 - dropped_count / double(total) : 1;
+    }
+
+    static double occupy_until_permeable(const Topology &topology, Mode mode, Random &rng, Workspace &ws) {
+        Counters &counters = ws.counters;
+        const size_t nodes = topology.node_count();
+        const size_t total = mode == Mode::EDGES ? topology.edge_count() : nodes;
+        // Two virtual roots are appended after the real nodes, so that spanning is a single connectivity query
+        const size_t source = nodes, target = nodes + 1;
+        UnionFind &clusters = ws.clusters;
+        {
+            LATTICE_TIME(counters.construction_seconds);
+            clusters.reset(nodes + 2);
+            ws.order.resize(total);
+            std::iota(ws.order.begin(), ws.order.end(), 0);
+            ws.occupied.reset(nodes);
+
+            // In the EDGES mode all the nodes are present from the start, so boundary nodes are attached at once
+            if (mode == Mode::EDGES) {
+                for (size_t node = 0; node < nodes; ++node) {
+                    Node::Type type = topology.type(node);
+                    if (type == Node::Type::SOURCE)
+                        clusters.unite(node, source);
+                    else if (type == Node::Type::TARGET)
+                        clusters.unite(node, target);
+                }
+            }
+        }
+
+        size_t occupied_count = 0;
+        bool spanning = clusters.connected(source, target);
+        while (occupied_count < total && !spanning) {
+            {
+                LATTICE_TIME(counters.removal_seconds);
+
+                // The permutation is drawn lazily, as the sweep usually stops well before all the elements are occupied
+                std::swap(ws.order[occupied_count], ws.order[occupied_count + rng.below(total - occupied_count)]);
+                size_t id = ws.order[occupied_count++];
+
+                if (mode == Mode::EDGES) {
+                    Edge edge = topology.endpoints(id);
+                    clusters.unite(edge.node_a, edge.node_b);
+                } else {
+                    ws.occupied.set(id);
+                    Node::Type type = topology.type(id);
+                    if (type == Node::Type::SOURCE)
+                        clusters.unite(id, source);
+                    else if (type == Node::Type::TARGET)
+                        clusters.unite(id, target);
+
+                    topology.for_each_neighbor(id, [&](size_t another_node, size_t) {
+                        if (ws.occupied.test(another_node))
+                            clusters.unite(id, another_node);
+                    });
+                }
+            }
+
+            LATTICE_TIME(counters.connectivity_seconds);
+            spanning = clusters.connected(source, target);
+        }
+
+        // A lattice which doesn't span even when fully occupied is never permeable, which the other engines report as 1
+        if (!spanning)
+            return 1;
+
+        // The element which connected the roots is exactly the one whose removal breaks the last path in the
+        // DROP_AND_DFS engine, so the fraction is reported the same way: as if it was already removed.
+        return occupied_count > 0 ? (occupied_count - 1) / double(total) : 0;
+    }
+
+    // Element e is removed at time Random::hash(key, e), and the time at which the last path breaks is found by
+    // bisection. Every pass rebuilds the removal mask from the hashes, so memory is one bit per element and one per node.
+    static double bisect_until_impermeable(const Topology &topology, Mode mode, Random &rng, Workspace &ws) {
+        Counters &counters = ws.counters;
+        const size_t total = mode == Mode::EDGES ? topology.edge_count() : topology.node_count();
+        const uint64_t key = rng();
+
+        // Invariant: removing the elements with times below lo keeps the lattice permeable, below hi doesn't
+        uint64_t lo = 0, hi = std::numeric_limits<uint64_t>::max();
+        size_t below_lo = 0, below_hi = total;
+
+        ws.removed.reset(total);
+        if (!spans(topology, mode, ws.removed, ws))
+            return 1;
+
+        while (below_hi - below_lo > 1 && hi - lo > 1) {
+            const uint64_t mid = lo + (hi - lo) / 2;
+            size_t below_mid = 0;
+            {
+                LATTICE_TIME(counters.removal_seconds);
+                ws.removed.reset(total);
+                for (size_t id = 0; id < total; ++id) {
+                    if (Random::hash(key, id) < mid) {
+                        ws.removed.set(id);
+                        ++below_mid;
+                    }
+                }
+            }
+
+            if (spans(topology, mode, ws.removed, ws)) {
+                lo = mid;
+                below_lo = below_mid;
+            } else {
+                hi = mid;
+                below_hi = below_mid;
+            }
+        }
+
+        return 1 - below_hi / double(total);
+    }
+
+    // Returns whether a TARGET node is reachable from a SOURCE one, flooding whole rows at once on the planar stencils.
+    static bool spans(const Topology &topology, Mode mode, const RemovalMask &removed, Workspace &ws) {
+        Counters &counters = ws.counters;
+        LATTICE_COUNT(counters.is_permeable_calls, 1);
+        LATTICE_TIME(counters.connectivity_seconds);
+        return search(topology, mode, removed, ws);
+    }
+
+    // Breadth-first search from all the SOURCE nodes
+    template<class AnyTopology>
+    static bool search(const AnyTopology &topology, Mode mode, const RemovalMask &removed, Workspace &ws) {
+        Counters &counters = ws.counters;
+        ws.visited.reset(topology.node_count());
+        std::deque<size_t> &frontier = ws.frontier;
+        frontier.clear();
+
+        for (size_t source : topology.sources()) {
+            if (mode == Mode::NODES && removed.test(source))
+                continue;
+            ws.visited.set(source);
+            frontier.push_back(source);
+        }
+
+        while (!frontier.empty()) {
+            const size_t from = frontier.front();
+            frontier.pop_front();
+            LATTICE_COUNT(counters.visited_nodes, 1);
+
+            if (topology.type(from) == Node::Type::TARGET) {
+                frontier.clear();
+                return true;
+            }
+
+            topology.for_each_neighbor(from, [&](size_t another_node, size_t edge) {
+                if (ws.visited.test(another_node))
+                    return;
+                if (mode == Mode::EDGES ? removed.test(edge) : removed.test(another_node))
+                    return;
+                ws.visited.set(another_node);
+                frontier.push_back(another_node);
+            });
+        }
+
+        return false;
+    }
+
+    static bool search(const SquareStencil &stencil, Mode mode, const RemovalMask &removed, Workspace &ws) {
+        return ws.flood.spans(stencil, mode, removed);
+    }
+
+    static bool search(const TriangularStencil &stencil, Mode mode, const RemovalMask &removed, Workspace &ws) {
+        return ws.flood.spans(stencil, mode, removed);
+    }
+
+    static bool search(const HexagonalStencil &stencil, Mode mode, const RemovalMask &removed, Workspace &ws) {
+        return ws.flood.spans(stencil, mode, removed);
+    }
+
+    // Looks for a path from a SOURCE to a TARGET node avoiding the removed elements, and stores it in ws.path and
+    // ws.on_path. Returns whether there is one. Nodes are visited in the same order as by a recursive DFS taking the
+    // neighbours in order, which on intact lattices heads straight for the target and yields short paths.
+    static bool find_path(const Topology &topology, Mode mode, const RemovalMask &removed, Workspace &ws) {
+        Counters &counters = ws.counters;
+        LATTICE_COUNT(counters.is_permeable_calls, 1);
+
+        const size_t nodes = topology.node_count();
+        ws.visited.reset(nodes);
+        ws.parent.resize(nodes);
+        ws.parent_edge.resize(nodes);
+        ws.on_path.reset(mode == Mode::EDGES ? topology.edge_count() : nodes);
+        ws.path.clear();
+
+        auto &stack = ws.stack;
+        auto &neighbors = ws.neighbors;
+        stack.clear();
+
+        for (size_t source : topology.sources()) {
+            if ((mode == Mode::NODES && removed.test(source)) || ws.visited.test(source))
+                continue;
+
+            stack.push_back({source, source, 0});
+            while (!stack.empty()) {
+                Workspace::Step step = stack.back();
+                stack.pop_back();
+                if (ws.visited.test(step.node))
+                    continue;
+
+                const size_t from = step.node;
+                ws.visited.set(from);
+                ws.parent[from] = step.parent;
+                ws.parent_edge[from] = step.edge;
+                LATTICE_COUNT(counters.visited_nodes, 1);
+
+                if (topology.type(from) == Node::Type::TARGET) {
+                    for (size_t node = from; ; node = ws.parent[node]) {
+                        const bool is_source = ws.parent[node] == node;
+                        ws.path.push_back(node);
+                        if (mode == Mode::NODES)
+                            ws.on_path.set(node);
+                        else if (!is_source)
+                            ws.on_path.set(ws.parent_edge[node]);
+                        if (is_source)
+                            break;
+                    }
+                    return true;
+                }
+
+                neighbors.clear();
+                topology.for_each_neighbor(from, [&](size_t another_node, size_t edge) {
+                    if (ws.visited.test(another_node))
+                        return;
+                    if (mode == Mode::EDGES ? removed.test(edge) : removed.test(another_node))
+                        return;
+                    neighbors.push_back({another_node, from, edge});
+                });
+                // Reversed, so that the first neighbour is popped first
+                stack.insert(stack.end(), neighbors.rbegin(), neighbors.rend());
+            }
+        }
+
+        return false;
+    }
+};
+
+}
+
+#endif //LATTICE_KERNEL_H
@@ -10,6 +10,12 @@ namespace lattice {
 
 class Lattice {
 public:
+    // IMPLICIT lattices don't build their node and edge tables: their topology is only available through a stencil,
+    // and nodes(), edges() and the drop methods throw std::logic_error.
+    enum Storage {
+        EXPLICIT, IMPLICIT
+    };
+
     virtual ~Lattice() = default;
 
     virtual const std::vector<Edge> &edges() const = 0;
@@ -21,7 +27,16 @@ public:
     virtual void drop_node(size_t node) = 0;
 
     virtual void drop_edge_between(size_t node_a, size_t node_b) = 0;
-};
 
+    virtual size_t node_count() const {
+        return nodes().size();
+    }
+
+    virtual size_t edge_count() const {
+        return edges().size();
     }
+};
+
+}
+
 #endif //LATTICE_LATTICE_H
@@ -0,0 +1,49 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include "lattice_type.h"
+#include "bcc_lattice.h"
+#include "cubic_lattice.h"
+#include "fcc_lattice.h"
+#include "hexagonal_lattice.h"
+#include "square_lattice.h"
+#include "triangular_lattice.h"
+
+namespace lattice {
+
+std::unique_ptr<Lattice> make_lattice(LatticeType type, size_t size, Lattice::Storage storage) {
+    switch (type) {
+        case HEXAGONAL:
+            return std::unique_ptr<Lattice>(new HexagonalLattice(size, storage));
+        case TRIANGULAR:
+            return std::unique_ptr<Lattice>(new TriangularLattice(size, storage));
+        case SQUARE:
+            return std::unique_ptr<Lattice>(new SquareLattice(size, storage));
+        case CUBIC:
+            return std::unique_ptr<Lattice>(new CubicLattice(size, storage));
+        case BCC:
+            return std::unique_ptr<Lattice>(new BccLattice(size, storage));
+        case FCC:
+            return std::unique_ptr<Lattice>(new FccLattice(size, storage));
+    }
+    return nullptr;
+}
+
+std::string lattice_name(LatticeType type) {
+    switch (type) {
+        case HEXAGONAL:
+            return "hexagonal";
+        case TRIANGULAR:
+            return "triangular";
+        case SQUARE:
+            return "square";
+        case CUBIC:
+            return "cubic";
+        case BCC:
+            return "bcc";
+        case FCC:
+            return "fcc";
+    }
+    return "unknown";
+}
+
+}
@@ -0,0 +1,23 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_LATTICE_TYPE_H
+#define LATTICE_LATTICE_TYPE_H
+
+#include <memory>
+#include <string>
+#include "lattice.h"
+
+namespace lattice {
+
+// Built-in lattices which can be created by name, e.g. when planning sweeps or reading result files
+enum LatticeType {
+    HEXAGONAL, TRIANGULAR, SQUARE, CUBIC, BCC, FCC
+};
+
+std::unique_ptr<Lattice> make_lattice(LatticeType type, size_t size, Lattice::Storage storage = Lattice::EXPLICIT);
+
+std::string lattice_name(LatticeType type);
+
+}
+
+#endif //LATTICE_LATTICE_TYPE_H
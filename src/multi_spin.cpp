@@ -0,0 +1,140 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <cmath>
+#include "multi_spin.h"
+#include "topology.h"
+
+namespace lattice {
+
+// Scratch memory of one worker: a word per element and per node, plus the relaxation worklist
+struct MultiSpinWorkspace {
+    std::vector<uint64_t> present;
+    std::vector<uint64_t> wet;
+    std::vector<size_t> pending;
+    std::vector<uint8_t> queued;
+};
+
+// Word whose bits are independently set with probability bits / 2^PRECISION. Going from the least significant bit of
+// p up, a set bit ORs in a random word and a clear one ANDs it in, so every result bit ends up set with probability
+// equal to the binary fraction read so far.
+static uint64_t bernoulli_word(uint64_t bits, Random &rng) {
+    if (bits == 0)
+        return 0;
+    if (bits >> MultiSpin::PRECISION)
+        return ~uint64_t(0);
+
+    uint64_t word = 0;
+    for (unsigned i = __builtin_ctzll(bits); i < MultiSpin::PRECISION; ++i)
+        word = (bits >> i) & 1 ? word | rng() : word & rng();
+    return word;
+}
+
+// Returns the mask of the 64 realizations in which a TARGET node is reachable from a SOURCE one
+template<class Topology>
+static uint64_t spanning_mask(const Topology &topology, ThresholdFinder::Mode mode, uint64_t bits, Random &rng,
+                              MultiSpinWorkspace &ws) {
+    const size_t nodes = topology.node_count();
+    const size_t total = mode == ThresholdFinder::EDGES ? topology.edge_count() : nodes;
+    ws.present.resize(total);
+    for (size_t id = 0; id < total; ++id)
+        ws.present[id] = bernoulli_word(bits, rng);
+
+    auto occupied = [&](size_t node) {
+        return mode == ThresholdFinder::NODES ? ws.present[node] : ~uint64_t(0);
+    };
+    auto open = [&](size_t edge) {
+        return mode == ThresholdFinder::EDGES ? ws.present[edge] : ~uint64_t(0);
+    };
+
+    ws.wet.assign(nodes, 0);
+    ws.queued.assign(nodes, 0);
+    ws.pending.clear();
+    for (size_t source : topology.sources()) {
+        ws.wet[source] = occupied(source);
+        ws.queued[source] = 1;
+        ws.pending.push_back(source);
+    }
+
+    // Relaxation: a node passes its wet bits on to every neighbour across the bonds open in the same realizations,
+    // and is taken again whenever it gets new ones. Realizations which already span needn't be followed any further.
+    uint64_t spanning = 0;
+    while (!ws.pending.empty() && spanning != ~uint64_t(0)) {
+        const size_t node = ws.pending.back();
+        ws.pending.pop_back();
+        ws.queued[node] = 0;
+
+        const uint64_t wet = ws.wet[node] & ~spanning;
+        if (topology.type(node) == Node::Type::TARGET)
+            spanning |= wet;
+
+        topology.for_each_neighbor(node, [&](size_t another_node, size_t edge) {
+            const uint64_t flow = wet & open(edge) & occupied(another_node) & ~ws.wet[another_node];
+            if (flow == 0)
+                return;
+            ws.wet[another_node] |= flow;
+            if (!ws.queued[another_node]) {
+                ws.queued[another_node] = 1;
+                ws.pending.push_back(another_node);
+            }
+        });
+    }
+    return spanning;
+}
+
+double MultiSpin::Result::fraction(size_t index) const {
+    return realizations > 0 ? spanning[index] / double(realizations) : 0;
+}
+
+double MultiSpin::Result::standard_error(size_t index) const {
+    return realizations > 0 ? std::sqrt(fraction(index) * (1 - fraction(index)) / realizations) : 0;
+}
+
+/* static */ MultiSpin::Result
+MultiSpin::run(const Lattice &lattice, ThresholdFinder::Mode mode, const std::vector<double> &probabilities,
+               size_t realizations, ThreadPool &pool, uint64_t seed) {
+    const size_t batches = (realizations + BATCH - 1) / BATCH;
+    std::vector<MultiSpinWorkspace> workspaces(pool.size());
+    std::vector<size_t> counts(batches * probabilities.size());
+
+    std::vector<uint64_t> bits(probabilities.size());
+    for (size_t i = 0; i < probabilities.size(); ++i) {
+        const double p = probabilities[i];
+        bits[i] = p <= 0 ? 0 : p >= 1 ? uint64_t(1) << PRECISION : uint64_t(std::ldexp(p, PRECISION));
+    }
+
+    pool.for_each_index(batches, [&](size_t batch, size_t worker) {
+        Random rng(seed, batch);
+        with_topology(lattice, [&](const auto &topology) {
+            for (size_t i = 0; i < probabilities.size(); ++i)
+                counts[batch * probabilities.size() + i] =
+                        __builtin_popcountll(spanning_mask(topology, mode, bits[i], rng, workspaces[worker]));
+            return 0;
+        });
+    });
+
+    Result result;
+    result.probabilities = probabilities;
+    result.spanning.assign(probabilities.size(), 0);
+    result.realizations = batches * BATCH;
+    result.seed = seed;
+    for (size_t batch = 0; batch < batches; ++batch)
+        for (size_t i = 0; i < probabilities.size(); ++i)
+            result.spanning[i] += counts[batch * probabilities.size() + i];
+    return result;
+}
+
+/* static */ double MultiSpin::bisect(const Lattice &lattice, ThresholdFinder::Mode mode, size_t realizations,
+                                      ThreadPool &pool, double tolerance, uint64_t seed) {
+    double low = 0, high = 1;
+    for (uint64_t step = 0; high - low > tolerance; ++step) {
+        const double middle = (low + high) / 2;
+        Result result = run(lattice, mode, {middle}, realizations, pool, Random(seed, step)());
+        if (result.fraction(0) >= 0.5)
+            high = middle;
+        else
+            low = middle;
+    }
+    return (low + high) / 2;
+}
+
+}
@@ -0,0 +1,54 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_MULTI_SPIN_H
+#define LATTICE_MULTI_SPIN_H
+
+#include <cstdint>
+#include <vector>
+#include "lattice.h"
+#include "random.h"
+#include "thread_pool.h"
+#include "threshold_finder.h"
+
+namespace lattice {
+
+/*
+ * Multi-spin coded spanning test at fixed occupation probabilities: bit k of every word belongs to the k-th of 64
+ * independent realizations, so each step of the connectivity relaxation handles all of them at once. Occupancy words
+ * are drawn from the binary expansion of p, which needs at most PRECISION generator calls per word instead of one per
+ * bit. In the EDGES mode every bond is present with probability p, in the NODES mode every site.
+ *
+ * Realizations come in batches of 64, batch b drawing from the stream (seed, b) for all the probabilities in turn, so
+ * the result doesn't depend on the number of threads.
+ */
+class MultiSpin {
+public:
+    static const size_t BATCH = 64;
+    // Bits of p used, it is effectively rounded down to a multiple of 2^-PRECISION
+    static const unsigned PRECISION = 24;
+
+    struct Result {
+        std::vector<double> probabilities;
+        // Spanning realizations at each probability
+        std::vector<size_t> spanning;
+        size_t realizations = 0;
+        // Master seed of the run, passing it back to run() reproduces the result exactly
+        uint64_t seed = 0;
+
+        double fraction(size_t index) const;
+        double standard_error(size_t index) const;
+    };
+
+    // Runs the given number of realizations, rounded up to a multiple of BATCH, at every probability.
+    static Result run(const Lattice &lattice, ThresholdFinder::Mode mode, const std::vector<double> &probabilities,
+                      size_t realizations, ThreadPool &pool, uint64_t seed = Random::entropy_seed());
+
+    // Bisects the probability at which half of the realizations span, running the given number of them per step
+    // until the bracket is narrower than the tolerance. Step i uses the stream (seed, i) as its master seed.
+    static double bisect(const Lattice &lattice, ThresholdFinder::Mode mode, size_t realizations, ThreadPool &pool,
+                         double tolerance = 1e-3, uint64_t seed = Random::entropy_seed());
+};
+
+}
+
+#endif //LATTICE_MULTI_SPIN_H
@@ -0,0 +1,98 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <algorithm>
+#include <numeric>
+#include "node_order.h"
+
+namespace lattice {
+
+static size_t dimensions(LatticeType type) {
+    return type == CUBIC || type == BCC || type == FCC ? 3 : 2;
+}
+
+static uint64_t morton_key(const uint32_t *axes, size_t count, unsigned bits) {
+    uint64_t key = 0;
+    for (unsigned bit = bits; bit-- > 0;)
+        for (size_t i = 0; i < count; ++i)
+            key = key << 1 | (axes[i] >> bit & 1);
+    return key;
+}
+
+// Skilling's transform of the coordinates into the transposed Hilbert index, which then interleaves like Morton's
+static uint64_t hilbert_key(uint32_t *axes, size_t count, unsigned bits) {
+    if (bits == 0)
+        return 0;
+    const uint32_t top = uint32_t(1) << (bits - 1);
+
+    for (uint32_t q = top; q > 1; q >>= 1) {
+        const uint32_t p = q - 1;
+        for (size_t i = 0; i < count; ++i) {
+            if (axes[i] & q) {
+                axes[0] ^= p;
+            } else {
+                const uint32_t t = (axes[0] ^ axes[i]) & p;
+                axes[0] ^= t;
+                axes[i] ^= t;
+            }
+        }
+    }
+
+    for (size_t i = 1; i < count; ++i)
+        axes[i] ^= axes[i - 1];
+    uint32_t t = 0;
+    for (uint32_t q = top; q > 1; q >>= 1)
+        if (axes[count - 1] & q)
+            t ^= q - 1;
+    for (size_t i = 0; i < count; ++i)
+        axes[i] ^= t;
+
+    return morton_key(axes, count, bits);
+}
+
+std::string order_name(NodeOrder order) {
+    switch (order) {
+        case ROW_MAJOR:
+            return "row_major";
+        case MORTON:
+            return "morton";
+        case HILBERT:
+            return "hilbert";
+    }
+    return "unknown";
+}
+
+std::vector<size_t> node_order(LatticeType type, size_t size, NodeOrder order) {
+    const size_t count = dimensions(type);
+    size_t nodes = 1;
+    for (size_t i = 0; i < count; ++i)
+        nodes *= size;
+
+    std::vector<size_t> ids(nodes);
+    std::iota(ids.begin(), ids.end(), 0);
+    if (order == ROW_MAJOR)
+        return ids;
+
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < size)
+        ++bits;
+
+    // Planar ids are row * size + column and volumetric ones (z * size + y) * size + x, the slowest axis going first
+    std::vector<uint64_t> keys(nodes);
+    for (size_t id = 0; id < nodes; ++id) {
+        uint32_t axes[3];
+        size_t rest = id;
+        for (size_t i = count; i-- > 0;) {
+            axes[i] = uint32_t(rest % size);
+            rest /= size;
+        }
+        keys[id] = order == MORTON ? morton_key(axes, count, bits) : hilbert_key(axes, count, bits);
+    }
+
+    std::vector<size_t> sorted(ids);
+    std::sort(sorted.begin(), sorted.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+    for (size_t position = 0; position < nodes; ++position)
+        ids[sorted[position]] = position;
+    return ids;
+}
+
+}
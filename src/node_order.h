@@ -0,0 +1,26 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_NODE_ORDER_H
+#define LATTICE_NODE_ORDER_H
+
+#include <string>
+#include <vector>
+#include "lattice_type.h"
+
+namespace lattice {
+
+// Numbering of the nodes of a built-in lattice. Space-filling curves keep nodes which are close on the lattice close in
+// memory too, which the row-major order only does along a row.
+enum NodeOrder {
+    ROW_MAJOR, MORTON, HILBERT
+};
+
+std::string order_name(NodeOrder order);
+
+// New id of every node of the lattice, indexed by its row-major id, when the nodes are numbered along the curve.
+// Sizes which aren't powers of two are covered by the curve of the enclosing power of two with the gaps skipped.
+std::vector<size_t> node_order(LatticeType type, size_t size, NodeOrder order);
+
+}
+
+#endif //LATTICE_NODE_ORDER_H
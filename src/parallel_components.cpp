@@ -0,0 +1,147 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "parallel_components.h"
+#include "topology.h"
+
+namespace lattice {
+
+double ParallelComponents::Result::fraction() const {
+    return realizations > 0 ? spanning / double(realizations) : 0;
+}
+
+double ParallelComponents::Result::standard_error() const {
+    return realizations > 0 ? std::sqrt(fraction() * (1 - fraction()) / realizations) : 0;
+}
+
+ParallelComponents::ParallelComponents(ThreadPool &pool) : m_pool(pool), m_nodes(0), m_capacity(0) {}
+
+uint32_t ParallelComponents::find(uint32_t node) const {
+    // Path halving: a lost race only leaves a longer path behind, every parent still leads to the same root
+    while (true) {
+        uint32_t parent = m_parent[node].load(std::memory_order_relaxed);
+        if (parent == node)
+            return node;
+        uint32_t grandparent = m_parent[parent].load(std::memory_order_relaxed);
+        if (grandparent != parent)
+            m_parent[node].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+        node = grandparent;
+    }
+}
+
+void ParallelComponents::unite(uint32_t a, uint32_t b) {
+    // The higher root is linked under the lower one, so labels end up as the smallest ids and no cycle can form
+    while (true) {
+        a = find(a);
+        b = find(b);
+        if (a == b)
+            return;
+        if (a < b)
+            std::swap(a, b);
+        uint32_t expected = a;
+        if (m_parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+            return;
+    }
+}
+
+size_t ParallelComponents::label(size_t node) const {
+    return find(uint32_t(node));
+}
+
+template<class Topology>
+bool ParallelComponents::spans(const Topology &topology, ThresholdFinder::Mode mode, double p, uint64_t key) {
+    const size_t nodes = topology.node_count();
+    if (nodes > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("Parallel components are limited to 2^32 nodes");
+    if (nodes > m_capacity) {
+        m_parent.reset(new std::atomic<uint32_t>[nodes]);
+        m_capacity = nodes;
+    }
+    m_nodes = nodes;
+
+    // Compared with the raw hash instead of converting it to a double
+    const bool always = p >= 1;
+    const uint64_t bound = p > 0 && p < 1 ? uint64_t(std::ldexp(p, 64)) : 0;
+    auto present = [&](size_t element) {
+        return always || Random::hash(key, element) < bound;
+    };
+    auto node_present = [&](size_t node) {
+        return mode == ThresholdFinder::EDGES || present(node);
+    };
+
+    // A few bands per worker, so that one band with more edges doesn't hold up the rest
+    const size_t bands = std::max<size_t>(1, std::min(nodes, 4 * m_pool.size()));
+    auto band_start = [&](size_t band) {
+        return band * nodes / bands;
+    };
+    m_crossing.resize(bands);
+
+    m_pool.for_each_index(bands, [&](size_t band, size_t) {
+        for (size_t node = band_start(band); node < band_start(band + 1); ++node)
+            m_parent[node].store(uint32_t(node), std::memory_order_relaxed);
+    });
+
+    m_pool.for_each_index(bands, [&](size_t band, size_t) {
+        const size_t first = band_start(band), last = band_start(band + 1);
+        auto &crossing = m_crossing[band];
+        crossing.clear();
+        for (size_t node = first; node < last; ++node) {
+            if (!node_present(node))
+                continue;
+            topology.for_each_neighbor(node, [&](size_t neighbor, size_t edge) {
+                if (neighbor <= node)
+                    return;
+                if (mode == ThresholdFinder::EDGES ? !present(edge) : !present(neighbor))
+                    return;
+                if (neighbor < last)
+                    unite(uint32_t(node), uint32_t(neighbor));
+                else
+                    crossing.emplace_back(uint32_t(node), uint32_t(neighbor));
+            });
+        }
+    });
+
+    m_pool.for_each_index(bands, [&](size_t band, size_t) {
+        for (const auto &edge : m_crossing[band])
+            unite(edge.first, edge.second);
+    });
+
+    m_source_roots.reset(nodes);
+    for (size_t source : topology.sources())
+        if (node_present(source))
+            m_source_roots.set(find(uint32_t(source)));
+
+    std::atomic<bool> spanning(false);
+    m_pool.for_each_index(bands, [&](size_t band, size_t) {
+        for (size_t node = band_start(band); node < band_start(band + 1) && !spanning.load(); ++node)
+            if (topology.type(node) == Node::Type::TARGET && node_present(node) &&
+                m_source_roots.test(find(uint32_t(node))))
+                spanning = true;
+    });
+    return spanning;
+}
+
+bool ParallelComponents::spans(const Lattice &lattice, ThresholdFinder::Mode mode, double p, uint64_t seed,
+                               size_t realization) {
+    const uint64_t key = Random(seed, realization)();
+    return with_topology(lattice, [&](const auto &topology) {
+        return spans(topology, mode, p, key);
+    });
+}
+
+/* static */ ParallelComponents::Result
+ParallelComponents::run(const Lattice &lattice, ThresholdFinder::Mode mode, double p, size_t realizations,
+                        ThreadPool &pool, uint64_t seed) {
+    ParallelComponents components(pool);
+    Result result;
+    result.seed = seed;
+    result.realizations = realizations;
+    for (size_t index = 0; index < realizations; ++index)
+        result.spanning += components.spans(lattice, mode, p, seed, index);
+    return result;
+}
+
+}
@@ -0,0 +1,73 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_PARALLEL_COMPONENTS_H
+#define LATTICE_PARALLEL_COMPONENTS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "lattice.h"
+#include "random.h"
+#include "removal_mask.h"
+#include "thread_pool.h"
+#include "threshold_finder.h"
+
+namespace lattice {
+
+/*
+ * Spanning test of a single realization at a fixed occupation probability with all the workers of a pool, for lattices
+ * so large that a handful of realizations is all a run can afford. Nodes are split into contiguous bands of ids, rows
+ * of the built-in lattices, and every band joins the clusters across its own edges into a shared lock-free union-find
+ * forest. The edges crossing to later bands are merged after that, roots being linked with compare-and-swap, and the
+ * test then looks for a TARGET node in the cluster of a SOURCE one.
+ *
+ * Element e of realization r is present when Random::hash(k, e) falls below p * 2^64, where k is the first output of
+ * the stream (seed, r). Presence is recomputed instead of being stored, and doesn't depend on the number of threads.
+ * In the EDGES mode every bond is present with probability p, in the NODES mode every site.
+ */
+class ParallelComponents {
+public:
+    struct Result {
+        size_t realizations = 0;
+        size_t spanning = 0;
+        // Master seed of the run, passing it back to run() reproduces the result exactly
+        uint64_t seed = 0;
+
+        double fraction() const;
+        double standard_error() const;
+    };
+
+    explicit ParallelComponents(ThreadPool &pool);
+
+    // Must not be called from a worker of the pool. Throws std::invalid_argument for 2^32 nodes or more.
+    bool spans(const Lattice &lattice, ThresholdFinder::Mode mode, double p, uint64_t seed, size_t realization);
+
+    // Smallest node id of the cluster of the node after the last spans(). Absent nodes are clusters of their own.
+    size_t label(size_t node) const;
+
+    // Runs the realizations one after another, each of them on the whole pool.
+    static Result run(const Lattice &lattice, ThresholdFinder::Mode mode, double p, size_t realizations,
+                      ThreadPool &pool, uint64_t seed = Random::entropy_seed());
+
+private:
+    ThreadPool &m_pool;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_parent;
+    size_t m_nodes;
+    size_t m_capacity;
+    // Edges from every band to a later one, joined once all the bands are done
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> m_crossing;
+    RemovalMask m_source_roots;
+
+    uint32_t find(uint32_t node) const;
+
+    void unite(uint32_t a, uint32_t b);
+
+    template<class Topology>
+    bool spans(const Topology &topology, ThresholdFinder::Mode mode, double p, uint64_t key);
+};
+
+}
+
+#endif //LATTICE_PARALLEL_COMPONENTS_H
@@ -0,0 +1,249 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <deque>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include "kernel.h"
+#include "process_runner.h"
+
+namespace lattice {
+
+struct Sample {
+    uint64_t index;
+    double threshold;
+};
+
+/*
+ * Shared memory of one worker. The ring is written by the worker alone and read by the coordinator alone, so a worker
+ * dying in the middle of a push leaves nothing but an unpublished slot behind.
+ */
+struct Channel {
+    // Samples pushed by the worker and taken by the coordinator so far
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    // Realizations [begin, end) to run next, valid once work is posted
+    std::atomic<uint64_t> begin;
+    std::atomic<uint64_t> end;
+    std::atomic<bool> stop;
+    sem_t work;
+    // Posted by the worker after every push, shared by all the channels (it lives in the first one)
+    sem_t *results;
+    uint64_t capacity;
+
+    Sample *ring() {
+        return reinterpret_cast<Sample *>(this + 1);
+    }
+};
+
+// Channels start on their own cache lines, after the semaphore shared by all of them
+static size_t cache_lines(size_t bytes) {
+    return (bytes + 63) / 64 * 64;
+}
+
+static void push(Channel &channel, uint64_t index, double threshold) {
+    const uint64_t head = channel.head.load(std::memory_order_relaxed);
+    while (head - channel.tail.load(std::memory_order_acquire) >= channel.capacity)
+        ::usleep(100);
+    channel.ring()[head % channel.capacity] = {index, threshold};
+    channel.head.store(head + 1, std::memory_order_release);
+    ::sem_post(channel.results);
+}
+
+/* static */ void ProcessRunner::serve(Channel &channel, const Options &options, ThresholdFinder::Mode mode,
+                                       const Lattice &lattice, ThresholdFinder::Engine engine, uint64_t seed) {
+#ifdef __linux__
+    // Workers must not outlive a coordinator which died without stopping them
+    ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+    if (options.memory_limit_bytes > 0) {
+        struct rlimit limit = {options.memory_limit_bytes, options.memory_limit_bytes};
+        ::setrlimit(RLIMIT_AS, &limit);
+    }
+
+    try {
+        Workspace workspace;
+        while (true) {
+            while (::sem_wait(&channel.work) != 0 && errno == EINTR) {}
+            if (channel.stop.load())
+                ::_exit(EXIT_SUCCESS);
+
+            const uint64_t end = channel.end.load();
+            for (uint64_t index = channel.begin.load(); index < end; ++index)
+                push(channel, index, ThresholdFinder::find_threshold(lattice, index, mode, engine, seed, workspace));
+        }
+    } catch (...) {
+    }
+    ::_exit(EXIT_FAILURE);
+}
+
+/* static */ ProcessRunner::Result
+ProcessRunner::run(size_t iterations, const Options &options, ThresholdFinder::Mode mode, const Lattice &lattice,
+                   ThresholdFinder::Engine engine, uint64_t seed) {
+    const size_t hardware = std::thread::hardware_concurrency();
+    const size_t processes = options.processes > 0 ? options.processes : hardware > 0 ? hardware : 4;
+    const size_t capacity = std::max<size_t>(options.ring_capacity, 1);
+    const size_t stride = cache_lines(sizeof(Channel) + capacity * sizeof(Sample));
+
+    const size_t length = cache_lines(sizeof(sem_t)) + processes * stride;
+    void *memory = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Can't map shared memory for the workers");
+
+    auto results = static_cast<sem_t *>(memory);
+    ::sem_init(results, 1, 0);
+    auto channel = [&](size_t worker) -> Channel & {
+        return *reinterpret_cast<Channel *>(static_cast<char *>(memory) + cache_lines(sizeof(sem_t)) + worker * stride);
+    };
+
+    std::vector<double> thresholds(iterations);
+    std::vector<bool> finished(iterations, false);
+    std::vector<size_t> attempts(iterations, 0);
+    std::vector<size_t> failed;
+    size_t completed = 0;
+
+    // Batches not handed out yet, failed ones go to the front so that the indices finish roughly in order
+    std::deque<std::pair<size_t, size_t>> queue;
+    for (size_t first = 0; first < iterations; first += std::max<size_t>(options.batch, 1))
+        queue.emplace_back(first, std::min(iterations, first + std::max<size_t>(options.batch, 1)));
+
+    // Per worker: its pid or -1 once it's gone for good, and the next index and the end of the batch it runs
+    std::vector<pid_t> pids(processes, -1);
+    std::vector<size_t> next(processes, 0), end(processes, 0);
+    size_t restarts = 0;
+
+    auto start = [&](size_t worker) {
+        Channel &ch = channel(worker);
+        new(&ch.head) std::atomic<uint64_t>(0);
+        new(&ch.tail) std::atomic<uint64_t>(0);
+        new(&ch.begin) std::atomic<uint64_t>(0);
+        new(&ch.end) std::atomic<uint64_t>(0);
+        new(&ch.stop) std::atomic<bool>(false);
+        ::sem_init(&ch.work, 1, 0);
+        ch.results = results;
+        ch.capacity = capacity;
+        next[worker] = end[worker] = 0;
+
+        const pid_t pid = ::fork();
+        if (pid == 0)
+            serve(ch, options, mode, lattice, engine, seed);
+        pids[worker] = pid;
+    };
+
+    auto drain = [&](size_t worker) {
+        Channel &ch = channel(worker);
+        const uint64_t head = ch.head.load(std::memory_order_acquire);
+        for (uint64_t i = ch.tail.load(std::memory_order_relaxed); i < head; ++i) {
+            const Sample sample = ch.ring()[i % capacity];
+            thresholds[sample.index] = sample.threshold;
+            finished[sample.index] = true;
+            ++completed;
+            next[worker] = sample.index + 1;
+        }
+        ch.tail.store(head, std::memory_order_release);
+    };
+
+    auto give_up = [&](size_t first, size_t last) {
+        for (size_t index = first; index < last; ++index)
+            failed.push_back(index);
+        completed += last - first;
+    };
+
+    for (size_t worker = 0; worker < processes; ++worker)
+        start(worker);
+    if (std::none_of(pids.begin(), pids.end(), [](pid_t pid) { return pid > 0; })) {
+        ::munmap(memory, length);
+        throw std::runtime_error("Can't start any worker process");
+    }
+
+    while (completed < iterations) {
+        struct timespec deadline;
+        ::clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 20 * 1000 * 1000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        ::sem_timedwait(results, &deadline);
+
+        for (size_t worker = 0; worker < processes; ++worker)
+            if (pids[worker] > 0)
+                drain(worker);
+
+        for (size_t worker = 0; worker < processes; ++worker) {
+            if (pids[worker] <= 0 || ::waitpid(pids[worker], nullptr, WNOHANG) != pids[worker])
+                continue;
+            drain(worker);
+
+            // The realization the worker died on is rerun a limited number of times, the rest of its batch is kept
+            if (next[worker] < end[worker]) {
+                size_t first = next[worker];
+                if (++attempts[first] > options.retries) {
+                    give_up(first, first + 1);
+                    ++first;
+                }
+                if (first < end[worker])
+                    queue.emplace_front(first, end[worker]);
+            }
+
+            pids[worker] = -1;
+            if (restarts < options.max_restarts) {
+                ++restarts;
+                start(worker);
+            }
+        }
+
+        const bool any_alive = std::any_of(pids.begin(), pids.end(), [](pid_t pid) { return pid > 0; });
+        if (!any_alive) {
+            for (const auto &batch : queue)
+                give_up(batch.first, batch.second);
+            queue.clear();
+        }
+
+        for (size_t worker = 0; worker < processes && !queue.empty(); ++worker) {
+            if (pids[worker] <= 0 || next[worker] < end[worker])
+                continue;
+            Channel &ch = channel(worker);
+            std::tie(next[worker], end[worker]) = queue.front();
+            queue.pop_front();
+            ch.begin.store(next[worker]);
+            ch.end.store(end[worker]);
+            ::sem_post(&ch.work);
+        }
+    }
+
+    for (size_t worker = 0; worker < processes; ++worker) {
+        if (pids[worker] <= 0)
+            continue;
+        channel(worker).stop.store(true);
+        ::sem_post(&channel(worker).work);
+        ::waitpid(pids[worker], nullptr, 0);
+    }
+    ::munmap(memory, length);
+
+    Result final;
+    std::vector<double> kept;
+    for (size_t index = 0; index < iterations; ++index)
+        if (finished[index])
+            kept.push_back(thresholds[index]);
+    final.result = ThresholdFinder::Result(kept);
+    final.result.seed = seed;
+    std::sort(failed.begin(), failed.end());
+    final.failed = failed;
+    final.restarts = restarts;
+    return final;
+}
+
+}
@@ -0,0 +1,63 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_PROCESS_RUNNER_H
+#define LATTICE_PROCESS_RUNNER_H
+
+#include <vector>
+#include "lattice.h"
+#include "random.h"
+#include "threshold_finder.h"
+
+namespace lattice {
+
+struct Channel;
+
+/*
+ * Runs the realizations of ThresholdFinder in forked worker processes (POSIX only), so that a crash, a stack overflow
+ * or running out of memory takes down one worker instead of the whole run. The lattice is built before forking and
+ * shared copy-on-write.
+ *
+ * The coordinator hands out batches of realization indices. Workers send back every threshold as soon as it's found
+ * through their own single-producer ring buffer in shared memory, so nothing finished is lost with a worker. A dead
+ * worker is replaced, and the realization it died on is retried. Realization i draws from the stream (seed, i) as in
+ * ThresholdFinder::run, so the thresholds don't depend on the number of processes or on the failures.
+ *
+ * Must be called while the process runs no other threads, as only the calling thread survives the fork.
+ */
+class ProcessRunner {
+public:
+    struct Options {
+        // Zero means one per available CPU
+        size_t processes = 0;
+        size_t batch = 64;
+        // Thresholds each worker may have in flight before it waits for the coordinator
+        size_t ring_capacity = 1024;
+        // Address space limit of every worker, zero for none. Exceeding it fails the worker instead of the machine.
+        size_t memory_limit_bytes = 0;
+        // Times a realization is rerun after its worker died on it, before it's given up as failed
+        size_t retries = 1;
+        // Workers replaced over the whole run. Once exhausted, realizations nobody is left to run are given up.
+        size_t max_restarts = 64;
+    };
+
+    struct Result {
+        // Thresholds of the finished realizations in the order of their indices
+        ThresholdFinder::Result result;
+        // Indices of the realizations given up, in increasing order
+        std::vector<size_t> failed;
+        size_t restarts = 0;
+    };
+
+    // Throws std::runtime_error if the shared memory can't be mapped or no worker can be started.
+    static Result run(size_t iterations, const Options &options, ThresholdFinder::Mode mode, const Lattice &lattice,
+                      ThresholdFinder::Engine engine = ThresholdFinder::DROP_AND_DFS,
+                      uint64_t seed = Random::entropy_seed());
+
+private:
+    [[noreturn]] static void serve(Channel &channel, const Options &options, ThresholdFinder::Mode mode,
+                                   const Lattice &lattice, ThresholdFinder::Engine engine, uint64_t seed);
+};
+
+}
+
+#endif //LATTICE_PROCESS_RUNNER_H
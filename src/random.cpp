@@ -0,0 +1,43 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <random>
+#include "random.h"
+
+namespace lattice {
+
+static uint64_t splitmix64(uint64_t &state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+Random::Random(uint64_t seed, uint64_t stream) {
+    // Both numbers are hashed before being combined, so neighbouring seeds and streams give unrelated states
+    uint64_t seed_state = seed, stream_state = ~stream;
+    uint64_t state = splitmix64(seed_state) ^ splitmix64(stream_state);
+    for (auto &word : m_state)
+        word = splitmix64(state);
+}
+
+uint64_t Random::below(uint64_t bound) {
+    uint64_t x = (*this)();
+    unsigned __int128 m = static_cast<unsigned __int128>(x) * bound;
+    uint64_t low = static_cast<uint64_t>(m);
+    if (low < bound) {
+        const uint64_t threshold = -bound % bound;
+        while (low < threshold) {
+            x = (*this)();
+            m = static_cast<unsigned __int128>(x) * bound;
+            low = static_cast<uint64_t>(m);
+        }
+    }
+    return static_cast<uint64_t>(m >> 64);
+}
+
+/* static */ uint64_t Random::entropy_seed() {
+    std::random_device dev;
+    return (static_cast<uint64_t>(dev()) << 32) ^ dev();
+}
+
+}
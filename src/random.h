@@ -0,0 +1,74 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_RANDOM_H
+#define LATTICE_RANDOM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace lattice {
+
+/*
+ * xoshiro256** generator seeded through SplitMix64 from a master seed and a stream number. Streams are meant to be
+ * indexed by realization rather than by thread, so that the outcome of a run does not depend on the thread count.
+ */
+class Random {
+public:
+    using result_type = uint64_t;
+
+    explicit Random(uint64_t seed, uint64_t stream = 0);
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()() {
+        const uint64_t result = rotl(m_state[1] * 5, 7) * 9;
+        const uint64_t t = m_state[1] << 17;
+
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotl(m_state[3], 45);
+
+        return result;
+    }
+
+    // Uniformly distributed integer in [0, bound), bound must be positive (Lemire's multiply-and-reject).
+    uint64_t below(uint64_t bound);
+
+    // Uniformly distributed double in [0, 1) with 53 random bits.
+    double uniform() {
+        return ((*this)() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Stateless SplitMix64 mix of a key and a counter: a random-looking value for every element which can be recomputed
+    // at any time instead of being stored.
+    static uint64_t hash(uint64_t key, uint64_t counter) {
+        uint64_t z = key + (counter + 1) * 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Random seed taken from std::random_device, for the runs which don't need to be reproducible.
+    static uint64_t entropy_seed();
+
+private:
+    uint64_t m_state[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+}
+
+#endif //LATTICE_RANDOM_H
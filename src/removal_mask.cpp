@@ -0,0 +1,20 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include "removal_mask.h"
+
+namespace lattice {
+
+RemovalMask::RemovalMask(size_t size) : m_size(0) {
+    reset(size);
+}
+
+void RemovalMask::reset(size_t size) {
+    m_size = size;
+    m_words.assign((size + 63) / 64, 0);
+}
+
+size_t RemovalMask::size() const {
+    return m_size;
+}
+
+}
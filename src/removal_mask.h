@@ -0,0 +1,42 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_REMOVAL_MASK_H
+#define LATTICE_REMOVAL_MASK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lattice {
+
+// One bit per edge or node of a shared lattice, set once the element is removed in the current realization.
+class RemovalMask {
+public:
+    explicit RemovalMask(size_t size = 0);
+
+    // Marks every element as present again, touching only size / 64 words.
+    void reset(size_t size);
+
+    bool test(size_t id) const {
+        return (m_words[id >> 6] >> (id & 63)) & 1;
+    }
+
+    void set(size_t id) {
+        m_words[id >> 6] |= uint64_t(1) << (id & 63);
+    }
+
+    size_t size() const;
+
+    // Bit i of the mask is bit i % 64 of word i / 64, bits past size() are zero
+    const uint64_t *words() const {
+        return m_words.data();
+    }
+
+private:
+    size_t m_size;
+    std::vector<uint64_t> m_words;
+};
+
+}
+
+#endif //LATTICE_REMOVAL_MASK_H
@@ -0,0 +1,166 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "result_file.h"
+
+namespace lattice {
+
+static const char MAGIC[8] = {'L', 'A', 'T', 'T', 'R', 'E', 'S', '\0'};
+static const uint32_t VERSION = 1;
+
+ResultWriter::ResultWriter(const std::string &path, size_t buffer_size)
+        : m_file(std::fopen(path.c_str(), "wb")), m_buffer(std::max<size_t>(buffer_size, 1)), m_used(0) {
+    if (m_file == nullptr)
+        throw std::runtime_error("Can't open " + path + " for writing");
+}
+
+ResultWriter::~ResultWriter() {
+    try {
+        close();
+    } catch (const std::runtime_error &) {
+        // Destructors must not throw, call close() explicitly to get I/O errors
+    }
+}
+
+void ResultWriter::write(LatticeType type, size_t size, ThresholdFinder::Mode mode, ThresholdFinder::Engine engine,
+                         const ThresholdFinder::Result &result) {
+    const Statistics &statistics = result.statistics;
+
+    RecordHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.lattice_type = type;
+    header.size = size;
+    header.mode = mode;
+    header.engine = engine;
+    header.seed = result.seed;
+    header.count = result.thresholds.size();
+    header.mean = statistics.mean();
+    header.variance = statistics.variance();
+    header.standard_error = statistics.standard_error();
+    header.min = statistics.min();
+    header.max = statistics.max();
+    header.histogram_low = statistics.low();
+    header.histogram_high = statistics.high();
+    header.histogram_bins = statistics.histogram().size();
+
+    std::vector<uint64_t> histogram(statistics.histogram().begin(), statistics.histogram().end());
+
+    append(&header, sizeof(header));
+    append(histogram.data(), histogram.size() * sizeof(uint64_t));
+    append(result.thresholds.data(), result.thresholds.size() * sizeof(double));
+}
+
+void ResultWriter::flush() {
+    if (m_file == nullptr)
+        return;
+    if (m_used > 0 && std::fwrite(m_buffer.data(), 1, m_used, m_file) != m_used)
+        throw std::runtime_error("Can't write results");
+    m_used = 0;
+    if (std::fflush(m_file) != 0)
+        throw std::runtime_error("Can't write results");
+}
+
+void ResultWriter::close() {
+    if (m_file == nullptr)
+        return;
+    flush();
+    std::FILE *file = m_file;
+    m_file = nullptr;
+    if (std::fclose(file) != 0)
+        throw std::runtime_error("Can't write results");
+}
+
+void ResultWriter::append(const void *data, size_t bytes) {
+    auto from = static_cast<const char *>(data);
+    while (bytes > 0) {
+        if (m_used == m_buffer.size()) {
+            if (std::fwrite(m_buffer.data(), 1, m_used, m_file) != m_used)
+                throw std::runtime_error("Can't write results");
+            m_used = 0;
+        }
+        size_t chunk = std::min(bytes, m_buffer.size() - m_used);
+        std::memcpy(m_buffer.data() + m_used, from, chunk);
+        m_used += chunk;
+        from += chunk;
+        bytes -= chunk;
+    }
+}
+
+ResultFile::ResultFile(const std::string &path) : m_data(nullptr), m_length(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Can't open " + path);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Can't stat " + path);
+    }
+    m_length = static_cast<size_t>(info.st_size);
+
+    if (m_length > 0) {
+        m_data = ::mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        if (m_data == MAP_FAILED) {
+            m_data = nullptr;
+            ::close(fd);
+            throw std::runtime_error("Can't map " + path);
+        }
+    }
+    ::close(fd);
+
+    auto bytes = static_cast<const char *>(m_data);
+    size_t offset = 0;
+    while (offset < m_length) {
+        auto header = reinterpret_cast<const RecordHeader *>(bytes + offset);
+        if (m_length - offset < sizeof(RecordHeader) || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            header->version != VERSION) {
+            unmap();
+            throw std::runtime_error(path + " is not a result file");
+        }
+
+        // The counts are bounded by the bytes left before multiplying, so that a corrupt one can't wrap around
+        size_t histogram_offset = offset + sizeof(RecordHeader);
+        if (header->histogram_bins > (m_length - histogram_offset) / sizeof(uint64_t)) {
+            unmap();
+            throw std::runtime_error(path + " is truncated");
+        }
+        size_t thresholds_offset = histogram_offset + header->histogram_bins * sizeof(uint64_t);
+        if (header->count > (m_length - thresholds_offset) / sizeof(double)) {
+            unmap();
+            throw std::runtime_error(path + " is truncated");
+        }
+        size_t end = thresholds_offset + header->count * sizeof(double);
+
+        m_records.push_back({
+                header,
+                reinterpret_cast<const uint64_t *>(bytes + histogram_offset),
+                reinterpret_cast<const double *>(bytes + thresholds_offset)
+        });
+        offset = end;
+    }
+}
+
+ResultFile::~ResultFile() {
+    unmap();
+}
+
+void ResultFile::unmap() {
+    if (m_data != nullptr)
+        ::munmap(m_data, m_length);
+    m_data = nullptr;
+}
+
+const std::vector<ResultFile::Record> &ResultFile::records() const {
+    return m_records;
+}
+
+}
@@ -0,0 +1,97 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_RESULT_FILE_H
+#define LATTICE_RESULT_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "lattice_type.h"
+#include "threshold_finder.h"
+
+namespace lattice {
+
+/*
+ * Binary result archive: a sequence of records, each made of a RecordHeader, the histogram bins (uint64) and the raw
+ * thresholds (double). Every part is 8-byte aligned and stored in the native (little-endian) byte order, so the
+ * columns can be used in place once the file is memory-mapped.
+ */
+struct RecordHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t lattice_type;
+    uint64_t size;
+    uint32_t mode;
+    uint32_t engine;
+    uint64_t seed;
+    uint64_t count;
+    double mean;
+    double variance;
+    double standard_error;
+    double min;
+    double max;
+    double histogram_low;
+    double histogram_high;
+    uint64_t histogram_bins;
+    uint64_t reserved[2];
+};
+
+static_assert(sizeof(RecordHeader) == 128, "RecordHeader layout must not depend on the compiler");
+
+// Appends records to a new file, in blocks of buffer_size bytes. Throws std::runtime_error on I/O errors.
+class ResultWriter {
+public:
+    explicit ResultWriter(const std::string &path, size_t buffer_size = 1 << 20);
+
+    ~ResultWriter();
+
+    ResultWriter(const ResultWriter &) = delete;
+
+    ResultWriter &operator=(const ResultWriter &) = delete;
+
+    void write(LatticeType type, size_t size, ThresholdFinder::Mode mode, ThresholdFinder::Engine engine,
+               const ThresholdFinder::Result &result);
+
+    void flush();
+
+    void close();
+
+private:
+    std::FILE *m_file;
+    std::vector<char> m_buffer;
+    size_t m_used;
+
+    void append(const void *data, size_t bytes);
+};
+
+// Read-only view of a memory-mapped archive. Throws std::runtime_error if the file can't be mapped or is malformed.
+class ResultFile {
+public:
+    struct Record {
+        const RecordHeader *header;
+        const uint64_t *histogram;
+        const double *thresholds;
+    };
+
+    explicit ResultFile(const std::string &path);
+
+    ~ResultFile();
+
+    ResultFile(const ResultFile &) = delete;
+
+    ResultFile &operator=(const ResultFile &) = delete;
+
+    const std::vector<Record> &records() const;
+
+private:
+    void *m_data;
+    size_t m_length;
+    std::vector<Record> m_records;
+
+    void unmap();
+};
+
+}
+
+#endif //LATTICE_RESULT_FILE_H
@@ -0,0 +1,112 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <algorithm>
+#include <cmath>
+#include "spanning_curve.h"
+
+namespace lattice {
+
+// Binomial probabilities of n = first ... first + weights.size() - 1 successes out of total trials, normalized
+static std::vector<double> binomial_weights(size_t total, double p, size_t &first) {
+    if (p <= 0 || p >= 1) {
+        first = p <= 0 ? 0 : total;
+        return {1.0};
+    }
+
+    const double up = p / (1 - p), cutoff = 1e-16;
+    const size_t mode = std::min(total, size_t(std::floor((total + 1) * p)));
+
+    std::vector<double> above = {1.0};
+    for (size_t n = mode; n < total && above.back() > cutoff; ++n)
+        above.push_back(above.back() * double(total - n) / double(n + 1) * up);
+
+    std::vector<double> below;
+    double weight = 1.0;
+    for (size_t n = mode; n > 0 && weight > cutoff; --n) {
+        weight *= double(n) / double(total - n + 1) / up;
+        below.push_back(weight);
+    }
+
+    first = mode - below.size();
+    std::vector<double> weights(below.rbegin(), below.rend());
+    weights.insert(weights.end(), above.begin(), above.end());
+
+    double sum = 0;
+    for (double w : weights)
+        sum += w;
+    for (double &w : weights)
+        w /= sum;
+    return weights;
+}
+
+SpanningCurve::SpanningCurve(const std::vector<double> &thresholds, size_t total,
+                             const std::vector<double> &probabilities)
+        : m_count(thresholds.size()), m_probabilities(probabilities) {
+    // The smallest number of elements with which each realization spans, total + 1 standing for never
+    std::vector<size_t> onsets;
+    onsets.reserve(thresholds.size());
+    for (double threshold : thresholds) {
+        const double onset = std::round(threshold * total) + 1;
+        onsets.push_back(size_t(std::min(std::max(onset, 0.0), double(total + 1))));
+    }
+    std::sort(onsets.begin(), onsets.end());
+
+    std::vector<size_t> multiplicity;
+    for (size_t i = 0; i < onsets.size(); ++i) {
+        if (i == 0 || onsets[i] != onsets[i - 1]) {
+            m_onsets.push_back(onsets[i]);
+            multiplicity.push_back(0);
+        }
+        ++multiplicity.back();
+    }
+    size_t spanning = 0;
+    for (size_t count : multiplicity) {
+        spanning += count;
+        m_spanning_from.push_back(spanning);
+    }
+
+    const double count = thresholds.size();
+    for (double p : probabilities) {
+        size_t first;
+        std::vector<double> weights = binomial_weights(total, p, first);
+
+        // tail[k] = P(n >= first + k), the probability that a realization with that onset spans
+        std::vector<double> tail(weights.size() + 1, 0);
+        for (size_t k = weights.size(); k-- > 0;)
+            tail[k] = tail[k + 1] + weights[k];
+
+        double sum = 0, sum_squares = 0;
+        for (size_t i = 0; i < m_onsets.size(); ++i) {
+            const size_t onset = m_onsets[i];
+            const double probability = onset <= first ? 1 : onset - first >= weights.size() ? 0 : tail[onset - first];
+            sum += multiplicity[i] * probability;
+            sum_squares += multiplicity[i] * probability * probability;
+        }
+
+        const double mean = count > 0 ? sum / count : 0;
+        const double variance = count > 1 ? std::max(0.0, (sum_squares - count * mean * mean) / (count - 1)) : 0;
+        m_spanning.push_back(mean);
+        m_standard_error.push_back(count > 0 ? std::sqrt(variance / count) : 0);
+    }
+}
+
+double SpanningCurve::microcanonical(size_t n) const {
+    auto last = std::upper_bound(m_onsets.begin(), m_onsets.end(), n);
+    if (last == m_onsets.begin() || m_count == 0)
+        return 0;
+    return m_spanning_from[last - m_onsets.begin() - 1] / double(m_count);
+}
+
+const std::vector<double> &SpanningCurve::probabilities() const {
+    return m_probabilities;
+}
+
+const std::vector<double> &SpanningCurve::spanning() const {
+    return m_spanning;
+}
+
+const std::vector<double> &SpanningCurve::standard_error() const {
+    return m_standard_error;
+}
+
+}
@@ -0,0 +1,49 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_SPANNING_CURVE_H
+#define LATTICE_SPANNING_CURVE_H
+
+#include <cstddef>
+#include <vector>
+
+namespace lattice {
+
+/*
+ * Spanning probability R_L(p) on a grid of occupation probabilities, computed from the thresholds of a single run.
+ *
+ * A realization reporting threshold t spans exactly when at least n_c = t * total + 1 of its total elements are
+ * present, so the thresholds give the microcanonical curve R_L(n), the fraction of realizations spanning with n
+ * elements, at every n at once. The canonical curve is its average over the binomial distribution of n,
+ * R_L(p) = sum_n C(total, n) p^n (1 - p)^(total - n) R_L(n), with the weights built outwards from the mode by their
+ * ratios, which avoids overflowing factorials and drops the ones below 1e-16 of the mode. Each p takes O(sqrt(total))
+ * operations plus one per distinct threshold, and memory doesn't grow with the lattice beyond the weights.
+ */
+class SpanningCurve {
+public:
+    // Thresholds of any engine, total being the number of edges or nodes of the lattice depending on the mode.
+    SpanningCurve(const std::vector<double> &thresholds, size_t total, const std::vector<double> &probabilities);
+
+    // R_L(n), the fraction of realizations spanning with n elements
+    double microcanonical(size_t n) const;
+
+    const std::vector<double> &probabilities() const;
+
+    const std::vector<double> &spanning() const;
+
+    // Standard error of each R_L(p) over the realizations
+    const std::vector<double> &standard_error() const;
+
+private:
+    // Distinct onsets n_c in increasing order and the number of realizations spanning from each of them on, so that
+    // memory depends on the number of realizations rather than on the size of the lattice
+    std::vector<size_t> m_onsets;
+    std::vector<size_t> m_spanning_from;
+    size_t m_count;
+    std::vector<double> m_probabilities;
+    std::vector<double> m_spanning;
+    std::vector<double> m_standard_error;
+};
+
+}
+
+#endif //LATTICE_SPANNING_CURVE_H
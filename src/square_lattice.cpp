@@ -2,13 +2,15 @@
 
 #include <algorithm>
 #include <numeric>
+#include <stdexcept>
 
 #include "square_lattice.h"
 
 namespace lattice {
 
-SquareLattice::SquareLattice(std::size_t size) : m_size(size) {
-    create_nodes();
+SquareLattice::SquareLattice(std::size_t size, Storage storage) : m_size(size), m_storage(storage) {
+    if (m_storage == EXPLICIT)
+        create_nodes();
 }
 
 void SquareLattice::create_nodes() {
@@ -71,10 +73,12 @@ void SquareLattice::create_nodes() {
 }
 
 const std::vector<Edge> &SquareLattice::edges() const {
+    require_tables();
     return m_edges;
 }
 
 const std::vector<Node> &SquareLattice::nodes() const {
+    require_tables();
     return m_nodes;
 }
 
@@ -84,11 +88,29 @@ std::vector<size_t> SquareLattice::source_idx() const {
     return idx;
 }
 
+SquareStencil SquareLattice::stencil() const {
+    return SquareStencil(m_size);
+}
+
+size_t SquareLattice::node_count() const {
+    return stencil().node_count();
+}
+
+size_t SquareLattice::edge_count() const {
+    return stencil().edge_count();
+}
+
+void SquareLattice::require_tables() const {
+    if (m_storage == IMPLICIT)
+        throw std::logic_error("An implicit lattice has no node and edge tables");
+}
+
 void SquareLattice::drop_node(size_t node_id) {
+    require_tables();
     Node &node = m_nodes[node_id];
 
     for (auto &edge : node.edges) {
-        size_t adj_node_id = m_edges[edge].node_b == node_id ? m_edges[edge].node_b : m_edges[edge].node_a;
+        size_t adj_node_id = m_edges[edge].node_b == node_id ? m_edges[edge].node_a : m_edges[edge].node_b;
 
         Node &adj_node = m_nodes[adj_node_id];
         size_t i;
@@ -103,6 +125,7 @@ void SquareLattice::drop_node(size_t node_id) {
 }
 
 void SquareLattice::drop_edge_between(size_t node_a, size_t node_b) {
+    require_tables();
     Node &node1 = m_nodes[node_a], &node2 = m_nodes[node_b];
     size_t i;
 
@@ -4,12 +4,13 @@
 #define LATTICE_SQUARE_LATTICE_H
 
 #include "lattice.h"
+#include "stencil.h"
 
 namespace lattice {
 
 class SquareLattice : public Lattice {
 public:
-    explicit SquareLattice(std::size_t size);
+    explicit SquareLattice(std::size_t size, Storage storage = EXPLICIT);
 
     const std::vector<Edge> &edges() const override;
 
@@ -21,12 +22,22 @@ public:
 
     void drop_edge_between(size_t node_a, size_t node_b) override;
 
+    size_t node_count() const override;
+
+    size_t edge_count() const override;
+
+    // Same topology as the tables above, computed from node and edge ids
+    SquareStencil stencil() const;
+
 private:
     const std::size_t m_size;
+    Storage m_storage;
     std::vector<Node> m_nodes;
     std::vector<Edge> m_edges;
 
     void create_nodes();
+
+    void require_tables() const;
 };
 
 }
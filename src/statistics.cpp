@@ -0,0 +1,91 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "statistics.h"
+
+namespace lattice {
+
+Statistics::Statistics(size_t bins, double low, double high)
+        : m_count(0), m_mean(0), m_m2(0), m_min(std::numeric_limits<double>::infinity()),
+          m_max(-std::numeric_limits<double>::infinity()), m_low(low), m_high(high), m_histogram(bins, 0) {
+}
+
+void Statistics::add(double value) {
+    ++m_count;
+    double delta = value - m_mean;
+    m_mean += delta / m_count;
+    m_m2 += delta * (value - m_mean);
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+
+    if (!m_histogram.empty()) {
+        double position = (value - m_low) / (m_high - m_low) * m_histogram.size();
+        size_t bin = position <= 0 ? 0 : std::min(static_cast<size_t>(position), m_histogram.size() - 1);
+        ++m_histogram[bin];
+    }
+}
+
+void Statistics::merge(const Statistics &another) {
+    if (another.m_count == 0)
+        return;
+
+    if (m_count == 0) {
+        *this = another;
+        return;
+    }
+
+    size_t count = m_count + another.m_count;
+    double delta = another.m_mean - m_mean;
+    m_mean += delta * another.m_count / count;
+    m_m2 += another.m_m2 + delta * delta * (double(m_count) * another.m_count / count);
+    m_count = count;
+    m_min = std::min(m_min, another.m_min);
+    m_max = std::max(m_max, another.m_max);
+
+    for (size_t i = 0; i < m_histogram.size() && i < another.m_histogram.size(); ++i)
+        m_histogram[i] += another.m_histogram[i];
+}
+
+size_t Statistics::count() const {
+    return m_count;
+}
+
+double Statistics::mean() const {
+    return m_mean;
+}
+
+double Statistics::variance() const {
+    return m_count > 1 ? m_m2 / (m_count - 1) : 0;
+}
+
+double Statistics::standard_error() const {
+    return m_count > 0 ? std::sqrt(variance() / m_count) : std::numeric_limits<double>::infinity();
+}
+
+double Statistics::interval_width(double z) const {
+    return 2 * z * standard_error();
+}
+
+double Statistics::min() const {
+    return m_min;
+}
+
+double Statistics::max() const {
+    return m_max;
+}
+
+double Statistics::low() const {
+    return m_low;
+}
+
+double Statistics::high() const {
+    return m_high;
+}
+
+const std::vector<size_t> &Statistics::histogram() const {
+    return m_histogram;
+}
+
+}
@@ -0,0 +1,60 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_STATISTICS_H
+#define LATTICE_STATISTICS_H
+
+#include <cstddef>
+#include <vector>
+
+namespace lattice {
+
+/*
+ * Streaming accumulator of thresholds: Welford's mean and variance plus a fixed-range histogram. Two accumulators
+ * over disjoint samples can be merged (Chan et al.), e.g. the ones of separate threads or batches.
+ */
+class Statistics {
+public:
+    explicit Statistics(size_t bins = 100, double low = 0, double high = 1);
+
+    void add(double value);
+
+    // Both accumulators must have the same histogram range and number of bins.
+    void merge(const Statistics &another);
+
+    size_t count() const;
+
+    double mean() const;
+
+    // Unbiased sample variance, zero for less than two values
+    double variance() const;
+
+    double standard_error() const;
+
+    // Full width of the normal-approximation confidence interval of the mean, z = 1.96 gives 95%
+    double interval_width(double z = 1.96) const;
+
+    double min() const;
+
+    double max() const;
+
+    double low() const;
+
+    double high() const;
+
+    // Values outside of [low, high) are counted in the first or the last bin
+    const std::vector<size_t> &histogram() const;
+
+private:
+    size_t m_count;
+    double m_mean;
+    double m_m2;
+    double m_min;
+    double m_max;
+    double m_low;
+    double m_high;
+    std::vector<size_t> m_histogram;
+};
+
+}
+
+#endif //LATTICE_STATISTICS_H
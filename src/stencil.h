@@ -0,0 +1,378 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_STENCIL_H
+#define LATTICE_STENCIL_H
+
+#include <cstddef>
+#include <vector>
+#include "edge.h"
+#include "node.h"
+
+namespace lattice {
+
+class BitFlood;
+
+/*
+ * Neighbourhoods of the built-in lattices computed from row and column instead of being looked up in the node and
+ * edge tables. Node and edge ids are exactly the ones assigned by create_nodes() of the matching lattice class, so a
+ * stencil can stand in for the tables without changing any results.
+ *
+ * Every stencil provides node_count(), edge_count(), type(node), endpoints(edge), sources() and
+ * for_each_neighbor(node, f), which calls f(neighbor, edge) for every adjacent node.
+ */
+class PlanarStencil {
+public:
+    explicit PlanarStencil(size_t size) : m_size(size) {}
+
+    size_t node_count() const {
+        return m_size * m_size;
+    }
+
+    Node::Type type(size_t node) const {
+        if (node < m_size)
+            return Node::Type::SOURCE;
+        if (node >= m_size * (m_size - 1))
+            return Node::Type::TARGET;
+        return Node::Type::INTERMEDIATE;
+    }
+
+    std::vector<size_t> sources() const {
+        std::vector<size_t> idx(m_size);
+        for (size_t i = 0; i < m_size; ++i)
+            idx[i] = i;
+        return idx;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+protected:
+    size_t m_size;
+};
+
+class SquareStencil : public PlanarStencil {
+public:
+    using PlanarStencil::PlanarStencil;
+
+    size_t edge_count() const {
+        return 2 * m_size * (m_size - 1);
+    }
+
+    Edge endpoints(size_t edge) const {
+        const size_t row = 2 * m_size - 1;
+        if (edge < (m_size - 1) * row) {
+            size_t node = edge / row * m_size + edge % row / 2;
+            return edge % row % 2 == 0 ? Edge{node, node + m_size} : Edge{node, node + 1};
+        }
+        size_t node = (m_size - 1) * m_size + (edge - (m_size - 1) * row);
+        return Edge{node, node + 1};
+    }
+
+    template<class F>
+    void for_each_neighbor(size_t node, F &&f) const {
+        const size_t i = node / m_size, j = node % m_size;
+        if (i < m_size - 1)
+            f(node + m_size, bottom(i, j));
+        if (j < m_size - 1)
+            f(node + 1, right(i, j));
+        if (j > 0)
+            f(node - 1, right(i, j - 1));
+        if (i > 0)
+            f(node - m_size, bottom(i - 1, j));
+    }
+
+    // Reads the edge numbering to lay bonds out as bit rows
+    friend class BitFlood;
+
+private:
+    // Every row but the last one holds a bottom and a right edge per node, except for the right one of the last node
+    size_t bottom(size_t i, size_t j) const {
+        return i * (2 * m_size - 1) + 2 * j;
+    }
+
+    size_t right(size_t i, size_t j) const {
+        return i < m_size - 1 ? bottom(i, j) + 1 : i * (2 * m_size - 1) + j;
+    }
+};
+
+class TriangularStencil : public PlanarStencil {
+public:
+    using PlanarStencil::PlanarStencil;
+
+    size_t edge_count() const {
+        return m_size == 0 ? 0 : (m_size - 1) * (3 * m_size - 1);
+    }
+
+    Edge endpoints(size_t edge) const {
+        const size_t row = 3 * m_size - 2;
+        if (edge >= (m_size - 1) * row) {
+            size_t node = (m_size - 1) * m_size + (edge - (m_size - 1) * row);
+            return Edge{node, node + 1};
+        }
+
+        const size_t i = edge / row;
+        const bool even = i % 2 == 0, odd = !even;
+        // The first node of an even row has no down-left edge, shifting it by one aligns the row to triples
+        size_t offset = edge % row + even;
+        size_t node = i * m_size + offset / 3;
+        switch (offset % 3) {
+            case 0:
+                return Edge{node, node + m_size - even};
+            case 1:
+                return Edge{node, node + m_size + odd};
+            default:
+                return Edge{node, node + 1};
+        }
+    }
+
+    template<class F>
+    void for_each_neighbor(size_t node, F &&f) const {
+        const size_t i = node / m_size, j = node % m_size;
+        const bool even = i % 2 == 0, odd = !even;
+
+        if (i < m_size - 1 && (j > 0 || odd))
+            f(node + m_size - even, down_left(i, j));
+        if (i < m_size - 1 && (j < m_size - 1 || even))
+            f(node + m_size + odd, down_right(i, j));
+        if (j > 0)
+            f(node - 1, right(i, j - 1));
+        if (j < m_size - 1)
+            f(node + 1, right(i, j));
+        if (i > 0 && (j > 0 || odd))
+            f(node - m_size - even, down_right(i - 1, j - even));
+        if (i > 0 && (j < m_size - 1 || even))
+            f(node - m_size + odd, down_left(i - 1, j + odd));
+    }
+
+    friend class BitFlood;
+
+private:
+    // Rows but the last one hold 3 * size - 2 edges, added in down-left, down-right, right order for every node
+    size_t row_base(size_t i) const {
+        return i * (3 * m_size - 2);
+    }
+
+    size_t down_left(size_t i, size_t j) const {
+        return row_base(i) + 3 * j - (i % 2 == 0);
+    }
+
+    size_t down_right(size_t i, size_t j) const {
+        return row_base(i) + 3 * j + (i % 2 == 1);
+    }
+
+    size_t right(size_t i, size_t j) const {
+        return i < m_size - 1 ? down_right(i, j) + 1 : row_base(i) + j;
+    }
+};
+
+class HexagonalStencil : public PlanarStencil {
+public:
+    using PlanarStencil::PlanarStencil;
+
+    size_t edge_count() const {
+        // m_size - 1 would wrap around for an empty lattice
+        if (m_size == 0)
+            return 0;
+        return row_base(m_size - 1) + horizontal_before(m_size - 1, m_size - 1);
+    }
+
+    Edge endpoints(size_t edge) const {
+        const size_t last = row_base(m_size - 1);
+        if (edge >= last) {
+            // The last row only holds horizontal edges, going right from the nodes of the row's parity
+            size_t node = (m_size - 1) * m_size + 2 * (edge - last) + (m_size - 1) % 2;
+            return Edge{node, node + 1};
+        }
+
+        const size_t pair = edge / (row_length(0) + row_length(1));
+        size_t offset = edge % (row_length(0) + row_length(1));
+        size_t i = 2 * pair;
+        if (offset >= row_length(0)) {
+            offset -= row_length(0);
+            ++i;
+        }
+
+        // A down edge per node and a right one for every node of the row's parity, i.e. D R D D R D ... in even rows
+        // and D D R D D R ... in odd ones, so skipping the first node of odd rows makes both of them periodic.
+        size_t j = 0;
+        if (i % 2 == 1) {
+            if (offset == 0)
+                return Edge{i * m_size, (i + 1) * m_size};
+            j = 1;
+            --offset;
+        }
+        j += 2 * (offset / 3) + (offset % 3 == 2);
+        size_t node = i * m_size + j;
+        return offset % 3 == 1 ? Edge{node, node + 1} : Edge{node, node + m_size};
+    }
+
+    template<class F>
+    void for_each_neighbor(size_t node, F &&f) const {
+        const size_t i = node / m_size, j = node % m_size;
+
+        if (i < m_size - 1)
+            f(node + m_size, down(i, j));
+        if (i % 2 == j % 2) {
+            if (j < m_size - 1)
+                f(node + 1, right(i, j));
+        } else if (j > 0) {
+            f(node - 1, right(i, j - 1));
+        }
+        if (i > 0)
+            f(node - m_size, down(i - 1, j));
+    }
+
+    friend class BitFlood;
+
+private:
+    // Number of nodes before column j of row i which have an edge to the right
+    size_t horizontal_before(size_t i, size_t j) const {
+        return i % 2 == 0 ? (j + 1) / 2 : j / 2;
+    }
+
+    size_t row_length(size_t parity) const {
+        return m_size + horizontal_before(parity, m_size - 1);
+    }
+
+    size_t row_base(size_t i) const {
+        return i / 2 * (row_length(0) + row_length(1)) + (i % 2) * row_length(0);
+    }
+
+    size_t down(size_t i, size_t j) const {
+        return row_base(i) + j + horizontal_before(i, j);
+    }
+
+    size_t right(size_t i, size_t j) const {
+        return i < m_size - 1 ? down(i, j) + 1 : row_base(i) + horizontal_before(i, j);
+    }
+};
+
+/*
+ * Volumetric lattices in a box of size^3 nodes with id (z * size + y) * size + x. Layer z = 0 is the SOURCE face and
+ * layer z = size - 1 the TARGET one. Bonds are given in the basis of the lattice's primitive vectors, so that BCC and
+ * FCC fit in the same cubic grid as the simple cubic lattice: the box is a parallelepiped of primitive cells rather
+ * than of conventional ones, which doesn't change the threshold in the thermodynamic limit.
+ *
+ * Edges are numbered direction by direction, and within a direction by their first node in id order.
+ */
+struct Offset {
+    int x, y, z;
+};
+
+template<size_t Directions>
+class BoxStencil {
+public:
+    BoxStencil(size_t size, const Offset (&offsets)[Directions]) : m_size(size) {
+        size_t base = 0;
+        for (size_t d = 0; d < Directions; ++d) {
+            m_offsets[d] = offsets[d];
+            m_base[d] = base;
+            base += span(offsets[d].x) * span(offsets[d].y) * span(offsets[d].z);
+            m_shift[d] = (long(offsets[d].z) * long(m_size) + offsets[d].y) * long(m_size) + offsets[d].x;
+        }
+        m_edge_count = base;
+    }
+
+    size_t node_count() const {
+        return m_size * m_size * m_size;
+    }
+
+    size_t edge_count() const {
+        return m_edge_count;
+    }
+
+    Node::Type type(size_t node) const {
+        if (node < m_size * m_size)
+            return Node::Type::SOURCE;
+        if (node >= m_size * m_size * (m_size - 1))
+            return Node::Type::TARGET;
+        return Node::Type::INTERMEDIATE;
+    }
+
+    std::vector<size_t> sources() const {
+        std::vector<size_t> idx(m_size * m_size);
+        for (size_t i = 0; i < idx.size(); ++i)
+            idx[i] = i;
+        return idx;
+    }
+
+    Edge endpoints(size_t edge) const {
+        size_t d = Directions - 1;
+        while (edge < m_base[d])
+            --d;
+        const Offset &o = m_offsets[d];
+        size_t offset = edge - m_base[d];
+        const size_t x = offset % span(o.x) + low(o.x);
+        offset /= span(o.x);
+        const size_t y = offset % span(o.y) + low(o.y);
+        const size_t z = offset / span(o.y) + low(o.z);
+        const size_t node = (z * m_size + y) * m_size + x;
+        return Edge{node, size_t(long(node) + m_shift[d])};
+    }
+
+    // Neighbours across the forward directions come first, the first direction being the one towards the target
+    template<class F>
+    void for_each_neighbor(size_t node, F &&f) const {
+        const size_t x = node % m_size, y = node / m_size % m_size, z = node / (m_size * m_size);
+        for (size_t d = 0; d < Directions; ++d)
+            if (inside(x, m_offsets[d].x) && inside(y, m_offsets[d].y) && inside(z, m_offsets[d].z))
+                f(size_t(long(node) + m_shift[d]), edge(d, x, y, z));
+        for (size_t d = 0; d < Directions; ++d)
+            if (inside(x, -m_offsets[d].x) && inside(y, -m_offsets[d].y) && inside(z, -m_offsets[d].z))
+                f(size_t(long(node) - m_shift[d]), edge(d, x - m_offsets[d].x, y - m_offsets[d].y, z - m_offsets[d].z));
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+private:
+    size_t m_size;
+    size_t m_edge_count;
+    Offset m_offsets[Directions];
+    size_t m_base[Directions];
+    long m_shift[Directions];
+
+    // Number of coordinates, and the lowest one, from which a step of delta stays inside the box
+    size_t span(int delta) const {
+        return m_size == 0 ? 0 : m_size - (delta != 0);
+    }
+
+    static size_t low(int delta) {
+        return delta < 0;
+    }
+
+    bool inside(size_t coordinate, int delta) const {
+        return delta == 0 || (delta > 0 ? coordinate + 1 < m_size : coordinate > 0);
+    }
+
+    size_t edge(size_t d, size_t x, size_t y, size_t z) const {
+        const Offset &o = m_offsets[d];
+        return m_base[d] + ((z - low(o.z)) * span(o.y) + (y - low(o.y))) * span(o.x) + (x - low(o.x));
+    }
+};
+
+// Simple cubic lattice: 6 neighbours
+class CubicStencil : public BoxStencil<3> {
+public:
+    explicit CubicStencil(size_t size) : BoxStencil<3>(size, {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}}) {}
+};
+
+// Body-centered cubic lattice: primitive vectors a1, a2, a3 and a1 + a2 + a3 give all the 8 nearest neighbours
+class BccStencil : public BoxStencil<4> {
+public:
+    explicit BccStencil(size_t size) : BoxStencil<4>(size, {{0, 0, 1}, {1, 1, 1}, {1, 0, 0}, {0, 1, 0}}) {}
+};
+
+// Face-centered cubic lattice: primitive vectors a1, a2, a3 and their pairwise differences give all the 12 nearest
+// neighbours
+class FccStencil : public BoxStencil<6> {
+public:
+    explicit FccStencil(size_t size)
+            : BoxStencil<6>(size, {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}, {1, -1, 0}, {0, 1, -1}, {1, 0, -1}}) {}
+};
+
+}
+
+#endif //LATTICE_STENCIL_H
@@ -0,0 +1,129 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "strip_spanning.h"
+
+namespace lattice {
+
+/* static */ const size_t StripSpanning::EMPTY = std::numeric_limits<size_t>::max();
+
+double StripSpanning::Result::fraction() const {
+    return realizations > 0 ? spanning / double(realizations) : 0;
+}
+
+double StripSpanning::Result::standard_error() const {
+    return realizations > 0 ? std::sqrt(fraction() * (1 - fraction()) / realizations) : 0;
+}
+
+StripSpanning::StripSpanning(LatticeType type, size_t width, ThresholdFinder::Mode mode)
+        : m_type(type), m_width(width), m_mode(mode), m_labels(width), m_occupied(width) {
+    if (type != SQUARE && type != TRIANGULAR && type != HEXAGONAL)
+        throw std::invalid_argument("Strips are only defined for the planar lattices");
+}
+
+bool StripSpanning::spans(size_t height, double p, Random &rng) {
+    // Compared with the raw generator output instead of converting it to a double
+    const bool always = p >= 1;
+    const uint64_t bound = p > 0 && p < 1 ? uint64_t(std::ldexp(p, 64)) : 0;
+    auto draw = [&]() {
+        return always || rng() < bound;
+    };
+
+    const size_t width = m_width;
+    size_t count = 0;
+    for (size_t i = 0; i < height; ++i) {
+        m_clusters.reset(count + width);
+        for (size_t j = 0; j < width; ++j)
+            m_occupied[j] = m_mode == ThresholdFinder::NODES ? draw() : 1;
+
+        // Previous row labels are 0 .. count - 1, the sites of the current row come after them
+        auto link = [&](size_t previous, size_t j) {
+            const bool open = m_mode == ThresholdFinder::EDGES ? draw() : true;
+            if (open && m_labels[previous] != EMPTY && m_occupied[j])
+                m_clusters.unite(m_labels[previous], count + j);
+        };
+
+        if (i > 0) {
+            const bool even = (i - 1) % 2 == 0;
+            for (size_t j = 0; j < width; ++j) {
+                if (m_type != TRIANGULAR) {
+                    link(j, j);
+                } else if (even) {
+                    if (j > 0)
+                        link(j, j - 1);
+                    link(j, j);
+                } else {
+                    link(j, j);
+                    if (j + 1 < width)
+                        link(j, j + 1);
+                }
+            }
+        }
+
+        for (size_t j = 0; j + 1 < width; ++j) {
+            if (m_type == HEXAGONAL && i % 2 != j % 2)
+                continue;
+            const bool open = m_mode == ThresholdFinder::EDGES ? draw() : true;
+            if (open && m_occupied[j] && m_occupied[j + 1])
+                m_clusters.unite(count + j, count + j + 1);
+        }
+
+        m_root_connected.assign(count + width, 0);
+        if (i == 0) {
+            for (size_t j = 0; j < width; ++j)
+                if (m_occupied[j])
+                    m_root_connected[m_clusters.find(count + j)] = 1;
+        } else {
+            for (size_t label = 0; label < count; ++label)
+                if (m_connected[label])
+                    m_root_connected[m_clusters.find(label)] = 1;
+        }
+
+        // Label recycling: the clusters present in the current row get labels 0, 1, ... in order of appearance
+        m_renumbered.assign(count + width, EMPTY);
+        m_connected.clear();
+        bool reaches_source = false;
+        for (size_t j = 0; j < width; ++j) {
+            if (!m_occupied[j]) {
+                m_labels[j] = EMPTY;
+                continue;
+            }
+            const size_t root = m_clusters.find(count + j);
+            if (m_renumbered[root] == EMPTY) {
+                m_renumbered[root] = m_connected.size();
+                m_connected.push_back(m_root_connected[root]);
+                reaches_source = reaches_source || m_root_connected[root];
+            }
+            m_labels[j] = m_renumbered[root];
+        }
+
+        if (!reaches_source)
+            return false;
+        count = m_connected.size();
+    }
+
+    return height > 0;
+}
+
+/* static */ StripSpanning::Result
+StripSpanning::run(LatticeType type, size_t width, size_t height, double p, ThresholdFinder::Mode mode,
+                   size_t realizations, ThreadPool &pool, uint64_t seed) {
+    std::vector<StripSpanning> workers(pool.size(), StripSpanning(type, width, mode));
+    std::vector<uint8_t> spanning(realizations);
+
+    pool.for_each_index(realizations, [&](size_t index, size_t worker) {
+        Random rng(seed, index);
+        spanning[index] = workers[worker].spans(height, p, rng);
+    });
+
+    Result result;
+    result.seed = seed;
+    result.realizations = realizations;
+    for (uint8_t spans : spanning)
+        result.spanning += spans;
+    return result;
+}
+
+}
@@ -0,0 +1,67 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_STRIP_SPANNING_H
+#define LATTICE_STRIP_SPANNING_H
+
+#include <cstdint>
+#include <vector>
+#include "lattice_type.h"
+#include "random.h"
+#include "thread_pool.h"
+#include "threshold_finder.h"
+#include "union_find.h"
+
+namespace lattice {
+
+/*
+ * Spanning test at a fixed occupation probability on width x height strips of the planar lattices, which are never
+ * stored: rows are generated one at a time and their clusters labelled as in Hoshen-Kopelman. Only the labels of the
+ * previous row are kept, renumbered after every row so that they stay below width, hence O(width) memory whatever the
+ * height.
+ *
+ * Rows and their edges are the same as in the SQUARE, TRIANGULAR and HEXAGONAL lattices, the first row being the
+ * SOURCE one and the last row the TARGET one. In the EDGES mode every bond is present with probability p, in the
+ * NODES mode every site.
+ */
+class StripSpanning {
+public:
+    struct Result {
+        size_t realizations = 0;
+        size_t spanning = 0;
+        // Master seed of the run, passing it back to run() reproduces the result exactly
+        uint64_t seed = 0;
+
+        double fraction() const;
+        double standard_error() const;
+    };
+
+    // Throws std::invalid_argument unless the type is one of the planar lattices.
+    StripSpanning(LatticeType type, size_t width, ThresholdFinder::Mode mode);
+
+    // Generates one strip, stopping as soon as no cluster of the current row reaches back to the first one.
+    bool spans(size_t height, double p, Random &rng);
+
+    // Realization i draws from the stream (seed, i), so the result doesn't depend on the number of threads.
+    static Result run(LatticeType type, size_t width, size_t height, double p, ThresholdFinder::Mode mode,
+                      size_t realizations, ThreadPool &pool, uint64_t seed = Random::entropy_seed());
+
+private:
+    static const size_t EMPTY;
+
+    LatticeType m_type;
+    size_t m_width;
+    ThresholdFinder::Mode m_mode;
+
+    // Compact labels of the previous row (EMPTY for unoccupied sites) and whether each label reaches the first row
+    std::vector<size_t> m_labels;
+    std::vector<uint8_t> m_connected;
+    std::vector<uint8_t> m_occupied;
+    // Labels of the previous row are merged with one provisional label per site of the current row
+    UnionFind m_clusters;
+    std::vector<uint8_t> m_root_connected;
+    std::vector<size_t> m_renumbered;
+};
+
+}
+
+#endif //LATTICE_STRIP_SPANNING_H
@@ -0,0 +1,101 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+#include "kernel.h"
+#include "sweep.h"
+
+namespace lattice {
+
+/* static */ std::vector<ThresholdFinder::Result>
+Sweep::run(const std::vector<Entry> &entries, ThreadPool &pool, ThresholdFinder::Engine engine, uint64_t seed,
+           const Callback &on_entry_done) {
+    // Entries of the same type and size share a lattice, which is released once the last of them is done
+    std::map<std::pair<LatticeType, size_t>, size_t> lattice_of;
+    std::vector<std::pair<LatticeType, size_t>> keys;
+    for (const auto &entry : entries) {
+        auto key = std::make_pair(entry.type, entry.size);
+        if (lattice_of.emplace(key, keys.size()).second)
+            keys.push_back(key);
+    }
+
+    // The kernels only read the stencils of the built-in lattices, so the node and edge tables are never built
+    std::vector<std::unique_ptr<Lattice>> lattices(keys.size());
+    pool.for_each_index(keys.size(), [&](size_t index, size_t) {
+        lattices[index] = make_lattice(keys[index].first, keys[index].second, Lattice::IMPLICIT);
+    });
+
+    std::vector<size_t> entry_lattice(entries.size());
+    std::vector<std::atomic<size_t>> entries_left(keys.size());
+    std::vector<std::atomic<size_t>> samples_left(entries.size());
+    std::vector<std::vector<double>> thresholds(entries.size());
+    std::vector<ThresholdFinder::Result> results(entries.size());
+    std::vector<size_t> cost(entries.size());
+    size_t total = 0;
+
+    for (size_t e = 0; e < entries.size(); ++e) {
+        const Entry &entry = entries[e];
+        entry_lattice[e] = lattice_of[std::make_pair(entry.type, entry.size)];
+        const Lattice &lat = *lattices[entry_lattice[e]];
+
+        ++entries_left[entry_lattice[e]];
+        samples_left[e] = entry.iterations;
+        thresholds[e].resize(entry.iterations);
+        results[e].seed = Random(seed, e)();
+        // A realization is at least linear in the number of elements it may remove or occupy
+        cost[e] = entry.mode == ThresholdFinder::EDGES ? lat.edge_count() : lat.node_count();
+        total += entry.iterations;
+    }
+
+    // Longest realizations go first, the short ones then fill the gaps at the end of the sweep
+    std::vector<std::pair<size_t, size_t>> plan;
+    plan.reserve(total);
+    std::vector<size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&cost](size_t a, size_t b) { return cost[a] > cost[b]; });
+    for (size_t e : order)
+        for (size_t i = 0; i < entries[e].iterations; ++i)
+            plan.emplace_back(e, i);
+
+    // Tasks don't own a particular realization: each of them takes the next one from the plan when it starts
+    std::atomic<size_t> next(0);
+    std::mutex callback_mutex;
+    std::vector<Workspace> workspaces(pool.size());
+
+    auto finish_entry = [&](size_t e) {
+        uint64_t entry_seed = results[e].seed;
+        results[e] = ThresholdFinder::Result(std::move(thresholds[e]));
+        results[e].seed = entry_seed;
+
+        if (on_entry_done) {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            on_entry_done(e, entries[e], results[e]);
+        }
+        if (--entries_left[entry_lattice[e]] == 0)
+            lattices[entry_lattice[e]].reset(nullptr);
+    };
+
+    // Entries without any realizations are reported straight away
+    for (size_t e = 0; e < entries.size(); ++e)
+        if (entries[e].iterations == 0)
+            finish_entry(e);
+
+    pool.for_each_index(total, [&](size_t, size_t worker) {
+        size_t e, i;
+        std::tie(e, i) = plan[next++];
+
+        const Lattice &lat = *lattices[entry_lattice[e]];
+        thresholds[e][i] = ThresholdFinder::find_threshold(lat, i, entries[e].mode, engine, results[e].seed,
+                                                           workspaces[worker]);
+        if (--samples_left[e] == 0)
+            finish_entry(e);
+    });
+
+    return results;
+}
+
+}
@@ -0,0 +1,39 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_SWEEP_H
+#define LATTICE_SWEEP_H
+
+#include <functional>
+#include <vector>
+#include "lattice_type.h"
+#include "thread_pool.h"
+#include "threshold_finder.h"
+
+namespace lattice {
+
+/*
+ * Runs many (lattice type, size) configurations as a single job. The realizations of all the entries are put on one
+ * pool and taken longest first, so the pool stays busy until the total work is done instead of draining after every
+ * entry.
+ */
+class Sweep {
+public:
+    struct Entry {
+        LatticeType type;
+        size_t size;
+        size_t iterations;
+        ThresholdFinder::Mode mode;
+    };
+
+    // Called from a worker thread once all the realizations of an entry are done, calls are never concurrent.
+    using Callback = std::function<void(size_t entry_index, const Entry &entry, const ThresholdFinder::Result &result)>;
+
+    // Entry i is seeded with the i-th stream of the master seed, its Result.seed reproduces it via ThresholdFinder::run.
+    static std::vector<ThresholdFinder::Result>
+    run(const std::vector<Entry> &entries, ThreadPool &pool, ThresholdFinder::Engine engine = ThresholdFinder::DROP_AND_DFS,
+        uint64_t seed = Random::entropy_seed(), const Callback &on_entry_done = nullptr);
+};
+
+}
+
+#endif //LATTICE_SWEEP_H
@@ -0,0 +1,144 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <exception>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "thread_pool.h"
+
+namespace lattice {
+
+// Identifies the pool and the worker the current thread belongs to, if any
+static thread_local const ThreadPool *current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+ThreadPool::ThreadPool(size_t threads, bool pin_threads) : m_pending(0), m_next_queue(0), m_stopping(false) {
+    if (threads == 0)
+        threads = 1;
+
+    for (size_t i = 0; i < threads; ++i)
+        m_queues.emplace_back(new Queue());
+
+    const size_t cpus = std::thread::hardware_concurrency();
+    for (size_t i = 0; i < threads; ++i) {
+        m_workers.emplace_back(&ThreadPool::work, this, i);
+        if (pin_threads && cpus > 0)
+            pin(m_workers.back(), i % cpus);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers)
+        worker.join();
+}
+
+size_t ThreadPool::size() const {
+    return m_workers.size();
+}
+
+void ThreadPool::submit(Task task) {
+    size_t queue = current_pool == this ? current_worker : m_next_queue++ % m_queues.size();
+    {
+        // The counter goes up first, so that it never drops below zero when the task is popped right away. Taking the
+        // mutex orders the increment with the sleeping workers' check of m_pending.
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        ++m_pending;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+        m_queues[queue]->tasks.push_back(std::move(task));
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::for_each_index(size_t count, const std::function<void(size_t index, size_t worker)> &body) {
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining = count;
+    std::exception_ptr error;
+
+    for (size_t i = 0; i < count; ++i) {
+        submit([&, i](size_t worker) {
+            try {
+                body(i, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0)
+                done.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&remaining]() { return remaining == 0; });
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void ThreadPool::work(size_t worker) {
+    current_pool = this;
+    current_worker = worker;
+
+    Task task;
+    while (true) {
+        if (pop(worker, task)) {
+            task(worker);
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_wake.wait(lock, [this]() { return m_stopping || m_pending > 0; });
+        if (m_stopping && m_pending == 0)
+            return;
+    }
+}
+
+bool ThreadPool::pop(size_t worker, Task &task) {
+    {
+        Queue &own = *m_queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --m_pending;
+            return true;
+        }
+    }
+
+    for (size_t k = 1; k < m_queues.size(); ++k) {
+        Queue &victim = *m_queues[(worker + k) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --m_pending;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* static */ void ThreadPool::pin(std::thread &thread, size_t cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &set);
+#else
+    (void) thread;
+    (void) cpu;
+#endif
+}
+
+}
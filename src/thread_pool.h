@@ -0,0 +1,68 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_THREAD_POOL_H
+#define LATTICE_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lattice {
+
+/*
+ * Persistent pool of workers, each owning a deque of tasks. A worker takes tasks from the back of its own deque and,
+ * once it runs dry, steals from the front of the others', so one slow task doesn't leave the rest of the pool idle.
+ * Tasks receive the index of the worker executing them, which lets callers keep per-worker scratch memory.
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void(size_t worker)>;
+
+    // With pin_threads, worker i is bound to CPU i modulo the number of CPUs (Linux only, ignored elsewhere).
+    explicit ThreadPool(size_t threads, bool pin_threads = false);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const;
+
+    // Tasks submitted from a worker go to its own deque, others are spread round-robin.
+    void submit(Task task);
+
+    // Runs body(i, worker) for every i in [0, count) and blocks until all of them finish. The first exception thrown
+    // by body is rethrown here. Must not be called from a worker of the same pool.
+    void for_each_index(size_t count, const std::function<void(size_t index, size_t worker)> &body);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_pending;
+    std::atomic<size_t> m_next_queue;
+    bool m_stopping;
+
+    void work(size_t worker);
+
+    bool pop(size_t worker, Task &task);
+
+    static void pin(std::thread &thread, size_t cpu);
+};
+
+}
+
+#endif //LATTICE_THREAD_POOL_H
@@ -1,150 +1,235 @@
 /* Copyright 2020, Sergey Popov (me@sergobot.me) */
 
-#include <future>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
 #include <numeric>
+#include <type_traits>
 #include "threshold_finder.h"
-#include "lattice.h"
+#include "kernel.h"
 
 namespace lattice {
 
+template<class Topology>
+static double sample(const Topology &topology, ThresholdFinder::Mode mode, ThresholdFinder::Engine engine, Random &rng,
+                     Workspace &workspace) {
+    if (engine == ThresholdFinder::UNION_FIND)
+        return Kernel<Topology>::occupy_until_permeable(topology, mode, rng, workspace);
+    if (engine == ThresholdFinder::BISECTION)
+        return Kernel<Topology>::bisect_until_impermeable(topology, mode, rng, workspace);
+    return Kernel<Topology>::drop_until_impermeable(topology, mode, rng, workspace);
+}
+
 ThresholdFinder::Result::Result(std::vector<double> th) : thresholds(std::move(th)) {
+    for (double threshold : thresholds)
+        statistics.add(threshold);
 }
 
 void ThresholdFinder::Result::append(const ThresholdFinder::Result &another) {
     thresholds.insert(thresholds.end(), another.thresholds.begin(), another.thresholds.end());
+    statistics.merge(another.statistics);
+    counters.merge(another.counters);
+
+    if (worker_counters.size() < another.worker_counters.size())
+        worker_counters.resize(another.worker_counters.size());
+    for (size_t i = 0; i < another.worker_counters.size(); ++i)
+        worker_counters[i].merge(another.worker_counters[i]);
+}
+
+bool ThresholdFinder::StopCondition::satisfied(const Statistics &statistics) const {
+    if (statistics.count() < std::max<size_t>(min_iterations, 2))
+        return false;
+    return (standard_error > 0 && statistics.standard_error() <= standard_error) ||
+           (interval_width > 0 && statistics.interval_width(z) <= interval_width);
 }
 
-double ThresholdFinder::Result::average() {
+double ThresholdFinder::Progress::samples_per_second() const {
+    return seconds > 0 ? done / seconds : 0;
+}
+
+double ThresholdFinder::Result::average() const {
     return std::accumulate(thresholds.begin(), thresholds.end(), 0.0) / thresholds.size();
 }
 
 /* static */ ThresholdFinder::Result
-ThresholdFinder::run(size_t iterations, size_t threads, Mode mode, const std::function<std::unique_ptr<Lattice>()> &generator) {
-    auto results = std::vector<std::future<Result>>();
-    for (size_t i = 0; i < threads; ++i) {
-        results.push_back(std::async(
-                &ThresholdFinder::find_threshold,
-                generator,
-                iterations / threads + (i < iterations % threads),
-                mode
-        ));
+ThresholdFinder::run(size_t iterations, size_t threads, Mode mode, const std::function<std::unique_ptr<Lattice>()> &generator,
+                     Engine engine, uint64_t seed) {
+    Counters construction;
+    std::unique_ptr<Lattice> lat;
+    {
+        LATTICE_TIME(construction.construction_seconds);
+        lat = generator();
     }
 
-    Result final;
-    for (auto &r : results) {
-        final.append(r.get());
-    }
+    Result final = run(iterations, threads, mode, *lat, engine, seed);
+    final.counters.construction_seconds += construction.construction_seconds;
+    return final;
+}
+
+/* static */ ThresholdFinder::Result
+ThresholdFinder::run(size_t iterations, size_t threads, Mode mode, const Lattice &lattice, Engine engine,
+                     uint64_t seed) {
+    ThreadPool pool(threads);
+    return run(iterations, pool, mode, lattice, engine, seed);
+}
 
+/* static */ ThresholdFinder::Result
+ThresholdFinder::run(size_t iterations, ThreadPool &pool, Mode mode, const Lattice &lattice, Engine engine,
+                     uint64_t seed) {
+    std::vector<Workspace> workspaces(pool.size());
+    std::vector<double> thresholds(iterations);
+
+    pool.for_each_index(iterations, [&](size_t index, size_t worker) {
+        thresholds[index] = find_threshold(lattice, index, mode, engine, seed, workspaces[worker]);
+    });
+
+    Result final(thresholds);
+    final.seed = seed;
+    collect_counters(final, workspaces);
     return final;
 }
 
 /* static */ ThresholdFinder::Result
-ThresholdFinder::find_threshold(const std::function<std::unique_ptr<Lattice>()> &generator, size_t iterations, Mode mode) {
-    std::random_device dev;
-    std::mt19937 rng(dev());
-
-    std::vector<double> thresholds;
-    std::vector<size_t> path;
-
-    for (size_t i = 0; i < iterations; ++i) {
-        auto lat = generator();
-        auto &nodes = lat->nodes();
-        auto &edges = lat->edges();
-
-        const size_t total = mode == EDGES ? edges.size() : nodes.size();
-        std::uniform_int_distribution<std::mt19937::result_type> dist(0, total - 1);
-
-        size_t dropped_count = 0;
-        do {
-            // If it's the first iteration on a given lattice, path will be empty and it's necessary to compute it
-            bool path_interrupted = path.size() == 0;
-
-            if (mode == EDGES) {
-                size_t edge_id, node_a, node_b;
-                bool settled = false;
-                do {
-                    edge_id = dist(rng);
-                    node_a = edges[edge_id].node_a;
-                    node_b = edges[edge_id].node_b;
-
-                    for (const size_t &edge : nodes[node_a].edges) {
-                        if (edge == edge_id) {
-                            settled = true;
-                            break;
-                        }
-                    }
-                } while (!settled);
-
-                lat->drop_edge_between(node_a, node_b);
-                if (path.size() > 0) {
-                    for (size_t k = 0; k < path.size() - 1; ++k) {
-                        if ((path[k] == node_a && path[k + 1] == node_b) || (path[k] == node_b && path[k + 1] == node_a)) {
-                            path_interrupted = true;
-                            break;
-                        }
-                    }
-                }
-            } else if (mode == NODES) {
-                size_t node_id;
-                do {
-                    node_id = dist(rng);
-                } while (nodes[node_id].edges.empty());
-
-                lat->drop_node(node_id);
-                if (path.size() > 0) {
-                    for (size_t k = 0; k < path.size(); ++k) {
-                        if (path[k] == node_id) {
-                            path_interrupted = true;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                return Result();
-            }
-            ++dropped_count;
-
-            if (path_interrupted)
-                path = is_permeable(*lat);
-        } while (path.size() > 0);
-        lat.reset(nullptr);
-        thresholds.push_back(1 - dropped_count / double(total));
-    }
-    return Result(thresholds);
+ThresholdFinder::run(size_t iterations, ThreadPool &pool, Mode mode, const Lattice &lattice,
+                     const SampleCallback &on_sample, Engine engine, uint64_t seed) {
+    std::vector<Workspace> workspaces(pool.size());
+    std::vector<double> thresholds(iterations);
+    std::vector<uint8_t> done(iterations, 0);
+    std::atomic<bool> cancelled(false);
+    std::mutex callback_mutex;
+
+    Progress progress;
+    progress.total = iterations;
+    const auto start = std::chrono::steady_clock::now();
+
+    pool.for_each_index(iterations, [&](size_t index, size_t worker) {
+        if (cancelled.load(std::memory_order_relaxed))
+            return;
+        double threshold = find_threshold(lattice, index, mode, engine, seed, workspaces[worker]);
+
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        thresholds[index] = threshold;
+        done[index] = 1;
+        ++progress.done;
+        progress.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (on_sample && !cancelled && !on_sample(index, threshold, progress))
+            cancelled = true;
+    });
+
+    std::vector<double> finished;
+    finished.reserve(progress.done);
+    for (size_t i = 0; i < iterations; ++i)
+        if (done[i])
+            finished.push_back(thresholds[i]);
+
+    Result final(finished);
+    final.seed = seed;
+    collect_counters(final, workspaces);
+    return final;
 }
 
-/* static */ std::vector<size_t> ThresholdFinder::is_permeable(const Lattice &lat) {
-    auto source_nodes = lat.source_idx();
-    std::deque<bool> visited(lat.nodes().size(), false);
-    std::vector<size_t> path;
+/* static */ ThresholdFinder::Result
+ThresholdFinder::run(size_t iterations, ThreadPool &pool, Mode mode, const Lattice &lattice, Checkpoint &checkpoint,
+                     Engine engine, uint64_t seed) {
+    Checkpoint::Snapshot snapshot;
+    if (checkpoint.load(snapshot)) {
+        if (snapshot.mode != uint32_t(mode) || snapshot.engine != uint32_t(engine) ||
+            snapshot.thresholds.size() != iterations || snapshot.nodes != lattice.node_count() ||
+            snapshot.edges != lattice.edge_count())
+            throw std::runtime_error(checkpoint.path() + " was saved by a different run");
+        seed = snapshot.seed;
+    } else {
+        snapshot.mode = mode;
+        snapshot.engine = engine;
+        snapshot.seed = seed;
+        snapshot.nodes = lattice.node_count();
+        snapshot.edges = lattice.edge_count();
+        snapshot.done.assign(iterations, 0);
+        snapshot.thresholds.assign(iterations, 0);
+    }
+
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < iterations; ++i)
+        if (!snapshot.done[i])
+            missing.push_back(i);
+
+    std::vector<Workspace> workspaces(pool.size());
+    std::mutex snapshot_mutex, save_mutex;
+
+    pool.for_each_index(missing.size(), [&](size_t index, size_t worker) {
+        const size_t i = missing[index];
+        double threshold = find_threshold(lattice, i, mode, engine, seed, workspaces[worker]);
+
+        std::unique_lock<std::mutex> lock(snapshot_mutex);
+        snapshot.thresholds[i] = threshold;
+        snapshot.done[i] = 1;
 
-    for (size_t node: source_nodes) {
-        if (!visited[node] && path_exists(lat, node, visited, path) > 0) {
-            break;
+        // Only one worker saves at a time, the others carry on instead of waiting for the disk
+        std::unique_lock<std::mutex> saving(save_mutex, std::try_to_lock);
+        if (saving && checkpoint.due()) {
+            Checkpoint::Snapshot copy = snapshot;
+            lock.unlock();
+            checkpoint.save(copy);
         }
-    }
+    });
+    checkpoint.save(snapshot);
 
-    return path;
+    Result final(snapshot.thresholds);
+    final.seed = seed;
+    collect_counters(final, workspaces);
+    return final;
 }
 
-/* static */ bool ThresholdFinder::path_exists(const Lattice &lat, const size_t &from, std::deque<bool> &visited, std::vector<size_t> &path) {
-    auto node = lat.nodes()[from];
-    visited[from] = true;
+/* static */ ThresholdFinder::Result
+ThresholdFinder::run_until(const StopCondition &condition, size_t max_iterations, ThreadPool &pool, Mode mode,
+                           const Lattice &lattice, Engine engine, uint64_t seed) {
+    std::vector<Workspace> workspaces(pool.size());
+    Result final;
+    final.seed = seed;
+
+    // The condition is only checked between batches, so the outcome depends on the seed and the batch size alone
+    while (final.thresholds.size() < max_iterations && !condition.satisfied(final.statistics)) {
+        const size_t first = final.thresholds.size();
+        std::vector<double> thresholds(std::min(std::max<size_t>(condition.batch, 1), max_iterations - first));
 
-    if (node.type == Node::Type::TARGET) {
-        path.push_back(from);
-        return true;
+        pool.for_each_index(thresholds.size(), [&](size_t index, size_t worker) {
+            thresholds[index] = find_threshold(lattice, first + index, mode, engine, seed, workspaces[worker]);
+        });
+        final.append(Result(thresholds));
     }
 
-    for (size_t &edge : node.edges) {
-        size_t another_node = from == lat.edges()[edge].node_b ? lat.edges()[edge].node_a : lat.edges()[edge].node_b;
-        if (!visited[another_node] && path_exists(lat, another_node, visited, path)) {
-            path.push_back(from);
-            return true;
-        }
+    collect_counters(final, workspaces);
+    return final;
+}
+
+/* static */ void ThresholdFinder::collect_counters(Result &result, const std::vector<Workspace> &workspaces) {
+    result.worker_counters.clear();
+    for (const auto &workspace : workspaces) {
+        result.worker_counters.push_back(workspace.counters);
+        result.counters.merge(workspace.counters);
     }
+}
+
+/* static */ double
+ThresholdFinder::find_threshold(const Lattice &lat, size_t index, Mode mode, Engine engine, uint64_t seed,
+                                Workspace &workspace) {
+    Random rng(seed, index);
+    LATTICE_COUNT(workspace.counters.realizations, 1);
+
+    return with_topology(lat, [&](const auto &topology) {
+        return sample(topology, mode, engine, rng, workspace);
+    });
+}
 
-    return false;
+/* static */ std::vector<size_t> ThresholdFinder::is_permeable(const Lattice &lat, Mode mode, const RemovalMask &removed) {
+    Workspace workspace;
+    with_topology(lat, [&](const auto &topology) {
+        using Topology = typename std::decay<decltype(topology)>::type;
+        return Kernel<Topology>::find_path(topology, mode, removed, workspace);
+    });
+    return workspace.path;
 }
 
 }
@@ -3,40 +3,121 @@
 #ifndef LATTICE_THRESHOLD_FINDER_H
 #define LATTICE_THRESHOLD_FINDER_H
 
-#include <random>
-#include <deque>
 #include <memory>
 #include <functional>
+#include "checkpoint.h"
+#include "instrumentation.h"
 #include "lattice.h"
+#include "random.h"
+#include "removal_mask.h"
+#include "statistics.h"
+#include "thread_pool.h"
+#include "union_find.h"
 
 namespace lattice {
 
+struct Workspace;
+
 class ThresholdFinder {
 public:
     enum Mode {
         EDGES, NODES
     };
 
+    // DROP_AND_DFS removes elements one by one and re-checks connectivity with a DFS whenever the cached path breaks.
+    // UNION_FIND occupies elements in random order (Newman-Ziff) and tracks clusters with a union-find forest instead.
+    // BISECTION gives every element a hashed removal time and bisects the time at which spanning is lost, storing
+    // nothing but two bitmaps per realization. It is meant for implicit lattices too large for the other engines.
+    enum Engine {
+        DROP_AND_DFS, UNION_FIND, BISECTION
+    };
+
     class Result {
     public:
         Result() = default;
         explicit Result(std::vector<double> th);
 
         void append(const Result &another);
-        double average();
+        double average() const;
         std::vector<double> thresholds;
+        // Accumulated alongside thresholds, in the order they were added
+        Statistics statistics;
+        // Master seed of the run, passing it back to run() reproduces the thresholds exactly
+        uint64_t seed = 0;
+        // Sum of worker_counters, see instrumentation.h for when they are collected
+        Counters counters;
+        std::vector<Counters> worker_counters;
+    };
+
+    // Target precision of run_until(). Whichever of the positive targets is met first stops the run.
+    struct StopCondition {
+        double standard_error = 0;
+        double interval_width = 0;
+        double z = 1.96;
+        // Never stop before this many realizations, as the variance estimate of a handful of them is unreliable
+        size_t min_iterations = 32;
+        // Realizations are run in batches of this size, which has to be fixed for the results to be reproducible
+        size_t batch = 256;
+
+        bool satisfied(const Statistics &statistics) const;
+    };
+
+    // Progress of a streaming run, as seen by its callback
+    struct Progress {
+        size_t done = 0;
+        size_t total = 0;
+        double seconds = 0;
+
+        double samples_per_second() const;
     };
 
+    // Receives every threshold as soon as it's found, with the progress including it. Returning false cancels the run.
+    using SampleCallback = std::function<bool(size_t index, double threshold, const Progress &progress)>;
+
     ThresholdFinder() = default;
 
-    static Result run(size_t iterations, size_t threads, Mode mode, const std::function<std::unique_ptr<Lattice>()> &generator);
+    // The generator is invoked once: the lattice it builds is shared read-only by all the threads.
+    static Result run(size_t iterations, size_t threads, Mode mode, const std::function<std::unique_ptr<Lattice>()> &generator,
+                      Engine engine = DROP_AND_DFS, uint64_t seed = Random::entropy_seed());
+
+    // Realization i always draws from the stream (seed, i), so the thresholds don't depend on the number of threads.
+    static Result run(size_t iterations, size_t threads, Mode mode, const Lattice &lattice, Engine engine = DROP_AND_DFS,
+                      uint64_t seed = Random::entropy_seed());
+
+    // Same as above, but every realization is a separate task on a pool which outlives the call.
+    static Result run(size_t iterations, ThreadPool &pool, Mode mode, const Lattice &lattice, Engine engine = DROP_AND_DFS,
+                      uint64_t seed = Random::entropy_seed());
+
+    // Saves the finished realizations to the checkpoint every its interval and once more at the end. If the checkpoint
+    // already exists, the run resumes it: the saved seed replaces the given one and only missing realizations are run.
+    // Throws std::runtime_error if the checkpoint belongs to a different configuration.
+    static Result run(size_t iterations, ThreadPool &pool, Mode mode, const Lattice &lattice, Checkpoint &checkpoint,
+                      Engine engine = DROP_AND_DFS, uint64_t seed = Random::entropy_seed());
+
+    // Calls on_sample from the workers as realizations finish, never concurrently and in no particular order of indices.
+    // Once it returns false, realizations not started yet are skipped and the run returns the finished ones in the
+    // order of their indices.
+    static Result run(size_t iterations, ThreadPool &pool, Mode mode, const Lattice &lattice,
+                      const SampleCallback &on_sample, Engine engine = DROP_AND_DFS,
+                      uint64_t seed = Random::entropy_seed());
+
+    // Runs realizations 0, 1, 2, ... until the condition holds or max_iterations are done.
+    static Result run_until(const StopCondition &condition, size_t max_iterations, ThreadPool &pool, Mode mode,
+                            const Lattice &lattice, Engine engine = DROP_AND_DFS, uint64_t seed = Random::entropy_seed());
+
+    // Path from a SOURCE to a TARGET node which avoids the removed edges or nodes, listed from the target back to the
+    // source, or an empty vector if there's none.
+    static std::vector<size_t> is_permeable(const Lattice &lat, Mode mode, const RemovalMask &removed);
 
 private:
-    static Result find_threshold(const std::function<std::unique_ptr<Lattice>()> &generator, size_t iterations, Mode mode);
+    friend class Sweep;
+    friend class FiniteSizeScaling;
+    friend class ProcessRunner;
 
-    static std::vector<size_t> is_permeable(const Lattice &lat);
+    static void collect_counters(Result &result, const std::vector<Workspace> &workspaces);
 
-    static bool path_exists(const Lattice &lat, const size_t &from, std::deque<bool> &visited, std::vector<size_t> &path);
+    static double find_threshold(const Lattice &lat, size_t index, Mode mode, Engine engine, uint64_t seed,
+                                 Workspace &workspace);
 };
 }
 
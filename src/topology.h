@@ -0,0 +1,79 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_TOPOLOGY_H
+#define LATTICE_TOPOLOGY_H
+
+#include <vector>
+#include "bcc_lattice.h"
+#include "cubic_lattice.h"
+#include "fcc_lattice.h"
+#include "graph_lattice.h"
+#include "hexagonal_lattice.h"
+#include "lattice.h"
+#include "square_lattice.h"
+#include "triangular_lattice.h"
+
+namespace lattice {
+
+// Topology of an arbitrary Lattice, read through its node and edge tables
+class LatticeTopology {
+public:
+    explicit LatticeTopology(const Lattice &lat) : m_lat(lat), m_nodes(lat.nodes()), m_edges(lat.edges()) {}
+
+    size_t node_count() const {
+        return m_nodes.size();
+    }
+
+    size_t edge_count() const {
+        return m_edges.size();
+    }
+
+    Node::Type type(size_t node) const {
+        return m_nodes[node].type;
+    }
+
+    Edge endpoints(size_t edge) const {
+        return m_edges[edge];
+    }
+
+    std::vector<size_t> sources() const {
+        return m_lat.source_idx();
+    }
+
+    template<class F>
+    void for_each_neighbor(size_t node, F &&f) const {
+        for (size_t edge : m_nodes[node].edges)
+            f(m_edges[edge].node_a == node ? m_edges[edge].node_b : m_edges[edge].node_a, edge);
+    }
+
+private:
+    const Lattice &m_lat;
+    const std::vector<Node> &m_nodes;
+    const std::vector<Edge> &m_edges;
+};
+
+// Calls f with the fastest topology available for the lattice: the built-in lattices get kernels with their
+// neighbourhoods computed inline, and implicit ones have no other; graphs are read from their mapped adjacency, and
+// any other lattice goes through its tables.
+template<class F>
+auto with_topology(const Lattice &lat, F &&f) -> decltype(f(LatticeTopology(lat))) {
+    if (auto square = dynamic_cast<const SquareLattice *>(&lat))
+        return f(square->stencil());
+    if (auto triangular = dynamic_cast<const TriangularLattice *>(&lat))
+        return f(triangular->stencil());
+    if (auto hexagonal = dynamic_cast<const HexagonalLattice *>(&lat))
+        return f(hexagonal->stencil());
+    if (auto cubic = dynamic_cast<const CubicLattice *>(&lat))
+        return f(cubic->stencil());
+    if (auto bcc = dynamic_cast<const BccLattice *>(&lat))
+        return f(bcc->stencil());
+    if (auto fcc = dynamic_cast<const FccLattice *>(&lat))
+        return f(fcc->stencil());
+    if (auto graph = dynamic_cast<const GraphLattice *>(&lat))
+        return f(graph->topology());
+    return f(LatticeTopology(lat));
+}
+
+}
+
+#endif //LATTICE_TOPOLOGY_H
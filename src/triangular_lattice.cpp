@@ -1,12 +1,14 @@
 /* Copyright 2020, Sergey Popov (me@sergobot.me) */
 
 #include <numeric>
+#include <stdexcept>
 #include "triangular_lattice.h"
 
 namespace lattice {
 
-TriangularLattice::TriangularLattice(size_t size) : m_size(size) {
-    create_nodes();
+TriangularLattice::TriangularLattice(size_t size, Storage storage) : m_size(size), m_storage(storage) {
+    if (m_storage == EXPLICIT)
+        create_nodes();
 }
 
 void TriangularLattice::create_nodes() {
@@ -106,10 +108,12 @@ void TriangularLattice::create_nodes() {
 }
 
 const std::vector<Node> &TriangularLattice::nodes() const {
+    require_tables();
     return this->m_nodes;
 }
 
 const std::vector<Edge> &TriangularLattice::edges() const {
+    require_tables();
     return this->m_edges;
 }
 
@@ -119,11 +123,29 @@ std::vector<size_t> TriangularLattice::source_idx() const {
     return idx;
 }
 
+TriangularStencil TriangularLattice::stencil() const {
+    return TriangularStencil(m_size);
+}
+
+size_t TriangularLattice::node_count() const {
+    return stencil().node_count();
+}
+
+size_t TriangularLattice::edge_count() const {
+    return stencil().edge_count();
+}
+
+void TriangularLattice::require_tables() const {
+    if (m_storage == IMPLICIT)
+        throw std::logic_error("An implicit lattice has no node and edge tables");
+}
+
 void TriangularLattice::drop_node(size_t node_id) {
+    require_tables();
     Node &node = m_nodes[node_id];
 
     for (auto &edge : node.edges) {
-        size_t adj_node_id = m_edges[edge].node_b == node_id ? m_edges[edge].node_b : m_edges[edge].node_a;
+        size_t adj_node_id = m_edges[edge].node_b == node_id ? m_edges[edge].node_a : m_edges[edge].node_b;
 
         Node &adj_node = m_nodes[adj_node_id];
         size_t i;
@@ -138,6 +160,7 @@ void TriangularLattice::drop_node(size_t node_id) {
 }
 
 void TriangularLattice::drop_edge_between(size_t node_a, size_t node_b) {
+    require_tables();
     Node &node1 = m_nodes[node_a], &node2 = m_nodes[node_b];
     size_t i;
 
@@ -0,0 +1,48 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <numeric>
+#include <utility>
+#include "union_find.h"
+
+namespace lattice {
+
+UnionFind::UnionFind(size_t size) {
+    reset(size);
+}
+
+void UnionFind::reset(size_t size) {
+    m_parent.resize(size);
+    m_size.assign(size, 1);
+    std::iota(m_parent.begin(), m_parent.end(), 0);
+}
+
+size_t UnionFind::find(size_t x) {
+    while (m_parent[x] != x) {
+        m_parent[x] = m_parent[m_parent[x]];
+        x = m_parent[x];
+    }
+    return x;
+}
+
+size_t UnionFind::unite(size_t a, size_t b) {
+    a = find(a);
+    b = find(b);
+    if (a == b)
+        return a;
+
+    if (m_size[a] < m_size[b])
+        std::swap(a, b);
+    m_parent[b] = a;
+    m_size[a] += m_size[b];
+    return a;
+}
+
+bool UnionFind::connected(size_t a, size_t b) {
+    return find(a) == find(b);
+}
+
+size_t UnionFind::size() const {
+    return m_parent.size();
+}
+
+}
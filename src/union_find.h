@@ -0,0 +1,35 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_UNION_FIND_H
+#define LATTICE_UNION_FIND_H
+
+#include <cstddef>
+#include <vector>
+
+namespace lattice {
+
+// Disjoint set forest with union by size and path halving.
+class UnionFind {
+public:
+    explicit UnionFind(size_t size = 0);
+
+    // Makes every element a singleton again, resizing the forest if necessary.
+    void reset(size_t size);
+
+    size_t find(size_t x);
+
+    // Returns the root of the merged set.
+    size_t unite(size_t a, size_t b);
+
+    bool connected(size_t a, size_t b);
+
+    size_t size() const;
+
+private:
+    std::vector<size_t> m_parent;
+    std::vector<size_t> m_size;
+};
+
+}
+
+#endif //LATTICE_UNION_FIND_H
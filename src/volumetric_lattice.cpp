@@ -0,0 +1,71 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#include <stdexcept>
+
+#include "volumetric_lattice.h"
+
+namespace lattice {
+
+VolumetricLattice::VolumetricLattice(size_t size, Storage storage) : m_size(size), m_storage(storage) {
+}
+
+const std::vector<Edge> &VolumetricLattice::edges() const {
+    require_tables();
+    return m_edges;
+}
+
+const std::vector<Node> &VolumetricLattice::nodes() const {
+    require_tables();
+    return m_nodes;
+}
+
+std::vector<size_t> VolumetricLattice::source_idx() const {
+    std::vector<size_t> idx(m_size * m_size);
+    for (size_t i = 0; i < idx.size(); ++i)
+        idx[i] = i;
+    return idx;
+}
+
+void VolumetricLattice::require_tables() const {
+    if (m_storage == IMPLICIT)
+        throw std::logic_error("An implicit lattice has no node and edge tables");
+}
+
+void VolumetricLattice::drop_node(size_t node_id) {
+    require_tables();
+    Node &node = m_nodes[node_id];
+
+    for (auto &edge : node.edges) {
+        size_t adj_node_id = m_edges[edge].node_b == node_id ? m_edges[edge].node_a : m_edges[edge].node_b;
+
+        Node &adj_node = m_nodes[adj_node_id];
+        size_t i;
+        for (i = 0; i < adj_node.edges.size(); ++i)
+            if (adj_node.edges[i] == edge)
+                break;
+        if (i < adj_node.edges.size())
+            adj_node.edges.erase(adj_node.edges.begin() + i);
+    }
+    node.edges.clear();
+    node.edges.shrink_to_fit();
+}
+
+void VolumetricLattice::drop_edge_between(size_t node_a, size_t node_b) {
+    require_tables();
+    Node &node1 = m_nodes[node_a], &node2 = m_nodes[node_b];
+    size_t i;
+
+    for (i = 0; i < node1.edges.size(); ++i)
+        if (m_edges[node1.edges[i]].node_a == node_b || m_edges[node1.edges[i]].node_b == node_b)
+            break;
+    if (i < node1.edges.size())
+        node1.edges.erase(node1.edges.begin() + i);
+
+    for (i = 0; i < node2.edges.size(); ++i)
+        if (m_edges[node2.edges[i]].node_a == node_a || m_edges[node2.edges[i]].node_b == node_a)
+            break;
+    if (i < node2.edges.size())
+        node2.edges.erase(node2.edges.begin() + i);
+}
+
+}
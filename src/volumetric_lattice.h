@@ -0,0 +1,61 @@
+/* Copyright 2020, Sergey Popov (me@sergobot.me) */
+
+#ifndef LATTICE_VOLUMETRIC_LATTICE_H
+#define LATTICE_VOLUMETRIC_LATTICE_H
+
+#include "lattice.h"
+#include "stencil.h"
+
+namespace lattice {
+
+/*
+ * Common part of the volumetric lattices, whose topology is entirely defined by a BoxStencil. Explicit tables are
+ * built from the stencil, so they always agree with it; at 256^3 and above only IMPLICIT storage is practical.
+ */
+class VolumetricLattice : public Lattice {
+public:
+    const std::vector<Edge> &edges() const override;
+
+    const std::vector<Node> &nodes() const override;
+
+    std::vector<size_t> source_idx() const override;
+
+    void drop_node(size_t node_id) override;
+
+    void drop_edge_between(size_t node_a, size_t node_b) override;
+
+protected:
+    VolumetricLattice(size_t size, Storage storage);
+
+    template<class Stencil>
+    void create_nodes(const Stencil &stencil) {
+        if (m_storage == IMPLICIT)
+            return;
+
+        m_edges.reserve(stencil.edge_count());
+        for (size_t edge = 0; edge < stencil.edge_count(); ++edge)
+            m_edges.push_back(stencil.endpoints(edge));
+
+        m_nodes.reserve(stencil.node_count());
+        for (size_t node = 0; node < stencil.node_count(); ++node) {
+            std::vector<size_t> edges;
+            stencil.for_each_neighbor(node, [&](size_t, size_t edge) {
+                edges.push_back(edge);
+            });
+            m_nodes.emplace_back(edges, stencil.type(node));
+        }
+    }
+
+    const size_t m_size;
+    Storage m_storage;
+
+private:
+    std::vector<Node> m_nodes;
+    std::vector<Edge> m_edges;
+
+    void require_tables() const;
+};
+
+}
+
+#endif //LATTICE_VOLUMETRIC_LATTICE_H